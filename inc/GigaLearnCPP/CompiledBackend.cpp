@@ -0,0 +1,42 @@
+#include "CompiledBackend.h"
+
+// Only built into exes configured with GGLBOT_COMPILED_MODEL
+#ifdef GGL_COMPILED_MODEL_HEADER
+
+#include GGL_COMPILED_MODEL_HEADER
+
+#include <random>
+
+GGL::CompiledInferenceBackend::CompiledInferenceBackend(int obsSize, int numActions) :
+	InferenceBackend(obsSize, numActions), _rng(std::random_device{}()) {
+
+	if (obsSize != CompiledModel::OBS_SIZE || numActions != CompiledModel::NUM_ACTIONS) {
+		RG_ERR_CLOSE(
+			"CompiledInferenceBackend: The compiled model maps " << CompiledModel::OBS_SIZE << " -> " << CompiledModel::NUM_ACTIONS <<
+			", expected " << obsSize << " -> " << numActions << " (regenerate " << GGL_COMPILED_MODEL_HEADER << " with GGLCodegen)"
+		);
+	}
+
+	_logits.resize(numActions);
+
+	RG_LOG("CompiledInferenceBackend: Using the model compiled into this exe from " << CompiledModel::SOURCE_FOLDER);
+}
+
+void GGL::CompiledInferenceBackend::InferLogits(const float* obs, int batchSize, float* outLogits) {
+	for (int i = 0; i < batchSize; i++)
+		CompiledModel::Forward(obs + (size_t)i * obsSize, outLogits + (size_t)i * numActions);
+}
+
+void GGL::CompiledInferenceBackend::InferActions(
+	const float* obs, const uint8_t* actionMasks, int batchSize,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	if (_logits.size() < (size_t)batchSize * numActions)
+		_logits.resize((size_t)batchSize * numActions);
+
+	InferLogits(obs, batchSize, _logits.data());
+	SelectMaskedActions(_logits.data(), numActions, actionMasks, batchSize, numActions, deterministic, temperature, outActions, outLogProbs, rngs, _rng);
+}
+
+#endif
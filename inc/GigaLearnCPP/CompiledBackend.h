@@ -0,0 +1,29 @@
+#pragma once
+
+#include "InferenceBackend.h"
+#include "NativeKernels.h"
+
+namespace GGL {
+
+	// Runs the network baked into the GGLCodegen header named by GGL_COMPILED_MODEL_HEADER (set by the GGLBOT_COMPILED_MODEL CMake option)
+	// Needs no model files and no libtorch, only available in builds with that header
+	class CompiledInferenceBackend : public InferenceBackend {
+	public:
+		// Sizes must match the ones the header was generated with
+		CompiledInferenceBackend(int obsSize, int numActions);
+
+		virtual const char* GetName() const override { return "compiled"; }
+
+		virtual void InferLogits(const float* obs, int batchSize, float* outLogits) override;
+
+		virtual void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) override;
+
+	private:
+		Native::AlignedVec<float> _logits;
+		FastRNG _rng;
+	};
+}
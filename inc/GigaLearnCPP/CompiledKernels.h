@@ -0,0 +1,70 @@
+#pragma once
+
+#include <GigaLearnCPP/InferenceModelConfig.h>
+
+#include <cmath>
+
+// Kernels used by model headers generated with GGLCodegen (see tools/GGLCodegen.cpp)
+// Every size is a template parameter, so the compiler sees fixed trip counts and can fully unroll and vectorize
+// Nothing here depends on libtorch
+
+#if defined(_MSC_VER)
+#define GGL_RESTRICT __restrict
+#else
+#define GGL_RESTRICT __restrict__
+#endif
+
+namespace GGL::Compiled {
+
+	// out = bias + in * W, with weightT stored transposed as [IN, OUT]
+	// The inner loop then runs over independent outputs, which vectorizes without needing fast-math reassociation
+	template <int IN, int OUT>
+	inline void Linear(const float* GGL_RESTRICT in, const float* GGL_RESTRICT weightT, const float* GGL_RESTRICT bias, float* GGL_RESTRICT out) {
+		for (int o = 0; o < OUT; o++)
+			out[o] = bias[o];
+
+		for (int i = 0; i < IN; i++) {
+			const float x = in[i];
+			const float* GGL_RESTRICT w = weightT + i * OUT;
+			for (int o = 0; o < OUT; o++)
+				out[o] += x * w[o];
+		}
+	}
+
+	// In-place LayerNorm, same two-pass mean/variance as libtorch
+	template <int SIZE>
+	inline void LayerNorm(float* GGL_RESTRICT data, const float* GGL_RESTRICT gamma, const float* GGL_RESTRICT beta, float eps) {
+		float mean = 0;
+		for (int i = 0; i < SIZE; i++)
+			mean += data[i];
+		mean /= SIZE;
+
+		float var = 0;
+		for (int i = 0; i < SIZE; i++) {
+			float d = data[i] - mean;
+			var += d * d;
+		}
+		var /= SIZE;
+
+		const float invStd = 1 / sqrtf(var + eps);
+		for (int i = 0; i < SIZE; i++)
+			data[i] = (data[i] - mean) * invStd * gamma[i] + beta[i];
+	}
+
+	// In-place activation, negativeSlope is only used by LEAKY_RELU
+	template <int SIZE, ModelActivationType TYPE>
+	inline void Activation(float* GGL_RESTRICT data, float negativeSlope) {
+		for (int i = 0; i < SIZE; i++) {
+			float x = data[i];
+			if constexpr (TYPE == ModelActivationType::RELU) {
+				data[i] = x > 0 ? x : 0;
+			} else if constexpr (TYPE == ModelActivationType::LEAKY_RELU) {
+				data[i] = x > 0 ? x : x * negativeSlope;
+			} else if constexpr (TYPE == ModelActivationType::SIGMOID) {
+				data[i] = 1 / (1 + expf(-x));
+			} else {
+				data[i] = tanhf(x);
+			}
+		}
+	}
+}
@@ -0,0 +1,212 @@
+#include "FlatWeights.h"
+#include "Hash.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	uint64_t AlignOffset(uint64_t offset) {
+		return (offset + GGL::FLAT_WEIGHTS_ALIGN - 1) / GGL::FLAT_WEIGHTS_ALIGN * GGL::FLAT_WEIGHTS_ALIGN;
+	}
+}
+
+uint64_t GGL::HashModelConfig(const ModelConfig& config) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	HashValue(hash, (int32_t)config.numInputs);
+	HashValue(hash, (int32_t)config.numOutputs);
+	HashValue(hash, (int32_t)config.layerSizes.size());
+	for (int size : config.layerSizes)
+		HashValue(hash, (int32_t)size);
+	HashValue(hash, (int32_t)config.activationType);
+	HashValue(hash, (uint8_t)config.addLayerNorm);
+	HashValue(hash, (uint8_t)config.addOutputLayer);
+	return hash;
+}
+
+//////////////////////////////////////////////
+
+std::shared_ptr<GGL::MappedFile> GGL::MappedFile::Open(const std::filesystem::path& path) {
+	std::shared_ptr<MappedFile> result(new MappedFile());
+
+#ifdef _WIN32
+	// FILE_SHARE_DELETE lets WriteFlatWeights() replace the file while it's mapped here
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		RG_ERR_CLOSE("MappedFile: Failed to open " << path);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		RG_ERR_CLOSE("MappedFile: Failed to open " << path);
+	}
+	result->_size = (size_t)fileSize.QuadPart;
+
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+		RG_ERR_CLOSE("MappedFile: Failed to create a mapping of " << path);
+
+	result->_mappingHandle = mapping;
+	result->_data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!result->_data)
+		RG_ERR_CLOSE("MappedFile: Failed to map " << path);
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		RG_ERR_CLOSE("MappedFile: Failed to open " << path);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		RG_ERR_CLOSE("MappedFile: Failed to open " << path);
+	}
+	result->_size = (size_t)st.st_size;
+
+	void* data = mmap(NULL, result->_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		RG_ERR_CLOSE("MappedFile: Failed to map " << path);
+
+	result->_data = (uint8_t*)data;
+#endif
+
+	return result;
+}
+
+GGL::MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mappingHandle)
+		CloseHandle(_mappingHandle);
+#else
+	if (_data)
+		munmap((void*)_data, _size);
+#endif
+}
+
+//////////////////////////////////////////////
+
+GGL::FlatWeightsFile GGL::FlatWeightsFile::Open(const std::filesystem::path& path) {
+	FlatWeightsFile result = {};
+	result.mapping = MappedFile::Open(path);
+
+	const uint8_t* data = result.mapping->GetData();
+	size_t size = result.mapping->GetSize();
+
+	if (size < sizeof(FlatWeightsHeader))
+		RG_ERR_CLOSE("FlatWeightsFile: " << path << " is too small to be a flat weight file");
+
+	auto header = (const FlatWeightsHeader*)data;
+	if (memcmp(header->magic, FLAT_WEIGHTS_MAGIC, sizeof(FLAT_WEIGHTS_MAGIC)) != 0)
+		RG_ERR_CLOSE("FlatWeightsFile: " << path << " is not a flat weight file");
+	if (header->version != FLAT_WEIGHTS_VERSION)
+		RG_ERR_CLOSE("FlatWeightsFile: " << path << " has version " << header->version << ", expected " << FLAT_WEIGHTS_VERSION << " (convert it again)");
+	if (header->fileSize != size || sizeof(FlatWeightsHeader) + (uint64_t)header->numTensors * sizeof(FlatTensorEntry) > size)
+		RG_ERR_CLOSE("FlatWeightsFile: " << path << " is truncated");
+
+	result.configHash = header->configHash;
+
+	auto entries = (const FlatTensorEntry*)(data + sizeof(FlatWeightsHeader));
+	for (uint32_t i = 0; i < header->numTensors; i++) {
+		auto& entry = entries[i];
+		if (entry.numDims > FLAT_MAX_DIMS || entry.dataOffset % FLAT_WEIGHTS_ALIGN != 0 || entry.dataOffset + entry.numel * sizeof(float) > size)
+			RG_ERR_CLOSE("FlatWeightsFile: Tensor " << i << " in " << path << " is out of bounds");
+
+		FlatTensorView view = {};
+		view.name = std::string(entry.name, strnlen(entry.name, sizeof(entry.name)));
+		view.shape.assign(entry.shape, entry.shape + entry.numDims);
+		view.data = (const float*)(data + entry.dataOffset);
+		view.numel = entry.numel;
+		result.tensors.push_back(std::move(view));
+	}
+
+	return result;
+}
+
+const GGL::FlatTensorView* GGL::FlatWeightsFile::Find(const std::string& name) const {
+	for (auto& tensor : tensors)
+		if (tensor.name == name)
+			return &tensor;
+	return NULL;
+}
+
+void GGL::WriteFlatWeights(const std::filesystem::path& path, uint64_t configHash, const std::vector<FlatTensorSource>& tensors) {
+	std::vector<FlatTensorEntry> entries(tensors.size());
+
+	uint64_t offset = AlignOffset(sizeof(FlatWeightsHeader) + tensors.size() * sizeof(FlatTensorEntry));
+	for (size_t i = 0; i < tensors.size(); i++) {
+		auto& tensor = tensors[i];
+		auto& entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+
+		if (tensor.name.size() >= sizeof(entry.name))
+			RG_ERR_CLOSE("WriteFlatWeights(): Tensor name \"" << tensor.name << "\" is too long");
+		if (tensor.shape.size() > FLAT_MAX_DIMS)
+			RG_ERR_CLOSE("WriteFlatWeights(): Tensor \"" << tensor.name << "\" has too many dimensions");
+
+		memcpy(entry.name, tensor.name.data(), tensor.name.size());
+		entry.numDims = (uint32_t)tensor.shape.size();
+		entry.numel = 1;
+		for (size_t j = 0; j < tensor.shape.size(); j++) {
+			entry.shape[j] = tensor.shape[j];
+			entry.numel *= tensor.shape[j];
+		}
+
+		entry.dataOffset = offset;
+		offset = AlignOffset(offset + entry.numel * sizeof(float));
+	}
+
+	FlatWeightsHeader header = {};
+	memcpy(header.magic, FLAT_WEIGHTS_MAGIC, sizeof(FLAT_WEIGHTS_MAGIC));
+	header.version = FLAT_WEIGHTS_VERSION;
+	header.numTensors = (uint32_t)tensors.size();
+	header.configHash = configHash;
+	header.fileSize = offset;
+
+	// Written next to the target and renamed over it, so a bot that has the old file mapped keeps its pages
+	// (rewriting it in place could fault or tear the weights under it)
+	auto tempPath = path;
+	tempPath += ".tmp";
+
+	std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+	if (!out.good())
+		RG_ERR_CLOSE("WriteFlatWeights(): Failed to open " << tempPath << " for writing");
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)entries.data(), entries.size() * sizeof(FlatTensorEntry));
+
+	const char zeros[FLAT_WEIGHTS_ALIGN] = {};
+	for (size_t i = 0; i < tensors.size(); i++) {
+		uint64_t pos = (uint64_t)out.tellp();
+		out.write(zeros, entries[i].dataOffset - pos);
+		out.write((const char*)tensors[i].data, entries[i].numel * sizeof(float));
+	}
+
+	uint64_t pos = (uint64_t)out.tellp();
+	out.write(zeros, header.fileSize - pos);
+
+	out.close();
+	if (!out.good()) {
+		std::error_code error;
+		std::filesystem::remove(tempPath, error);
+		RG_ERR_CLOSE("WriteFlatWeights(): Failed to write " << tempPath);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		RG_ERR_CLOSE("WriteFlatWeights(): Failed to replace " << path << " with " << tempPath);
+	}
+}
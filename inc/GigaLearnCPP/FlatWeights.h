@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GigaLearnCPP/InferenceModelConfig.h>
+#include <filesystem>
+#include <memory>
+
+namespace GGL {
+
+	// Flat weight file (.ggw), written by GGLFlatten from a .lt checkpoint
+	// Layout: FlatWeightsHeader, numTensors FlatTensorEntry, then the raw fp32 tensors, each aligned to FLAT_WEIGHTS_ALIGN
+	// The file is memory-mapped instead of parsed, so loading is near-instant and every process on the host shares the same pages
+	constexpr char FLAT_WEIGHTS_MAGIC[8] = { 'G', 'G', 'L', 'F', 'L', 'A', 'T', 'W' };
+	constexpr uint32_t FLAT_WEIGHTS_VERSION = 1;
+	constexpr size_t FLAT_WEIGHTS_ALIGN = 64;
+	constexpr int FLAT_MAX_DIMS = 4;
+
+	struct FlatWeightsHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t numTensors;
+		uint64_t configHash; // See HashModelConfig()
+		uint64_t fileSize;
+	};
+
+	struct FlatTensorEntry {
+		char name[64]; // Parameter name within the model's Sequential (e.g. "0.weight"), null-terminated
+		uint32_t numDims;
+		uint32_t _pad;
+		int64_t shape[FLAT_MAX_DIMS];
+		uint64_t dataOffset; // Bytes from the start of the file
+		uint64_t numel;
+	};
+
+	// Identifies the layer structure a set of weights was saved for
+	uint64_t HashModelConfig(const ModelConfig& config);
+
+	// Read-only mapping of a whole file
+	// Pages are shared with every other process mapping the same file, writing to them faults
+	class MappedFile {
+	public:
+		~MappedFile();
+		RG_NO_COPY(MappedFile);
+
+		static std::shared_ptr<MappedFile> Open(const std::filesystem::path& path);
+
+		const uint8_t* GetData() const { return _data; }
+		size_t GetSize() const { return _size; }
+
+	private:
+		MappedFile() = default;
+
+		const uint8_t* _data = NULL;
+		size_t _size = 0;
+#ifdef _WIN32
+		void* _mappingHandle = NULL;
+#endif
+	};
+
+	struct FlatTensorView {
+		std::string name;
+		std::vector<int64_t> shape;
+		const float* data; // Points into the read-only mapping
+		uint64_t numel;
+	};
+
+	struct FlatWeightsFile {
+		std::shared_ptr<MappedFile> mapping;
+		uint64_t configHash = 0;
+		std::vector<FlatTensorView> tensors;
+
+		// Maps and validates the file, throws on a bad header or out-of-bounds tensor
+		static FlatWeightsFile Open(const std::filesystem::path& path);
+
+		const FlatTensorView* Find(const std::string& name) const;
+	};
+
+	struct FlatTensorSource {
+		std::string name;
+		std::vector<int64_t> shape;
+		const float* data;
+	};
+
+	void WriteFlatWeights(const std::filesystem::path& path, uint64_t configHash, const std::vector<FlatTensorSource>& tensors);
+}
@@ -28,6 +28,36 @@ namespace GGL {
 		return torch::tensor(list.data).reshape({ (int64_t)list.size[0], (int64_t)list.size[1] });
 	}
 
+	// Copies a host buffer into a new tensor
+	template <typename T>
+	inline torch::Tensor PTR_TO_TENSOR(const T* data, torch::IntArrayRef shape) {
+		return torch::from_blob((T*)data, shape, torch::CppTypeToScalarType<T>()).clone();
+	}
+
+	// Wraps a host buffer without copying, the buffer must outlive the tensor
+	template <typename T>
+	inline torch::Tensor PTR_TO_TENSOR_VIEW(const T* data, int64_t size0, int64_t size1) {
+		return torch::from_blob((T*)data, { size0, size1 }, torch::CppTypeToScalarType<T>());
+	}
+
+	// Like TENSOR_TO_VEC, but writes into an existing buffer of at least tensor.size(0) elements
+	template <typename T>
+	inline void TENSOR_COPY_TO(torch::Tensor tensor, T* out) {
+		assert(tensor.dim() == 1);
+		tensor = tensor.contiguous().cpu().detach();
+		int64_t size = tensor.size(0);
+
+		if (tensor.scalar_type() == torch::kLong) {
+			// Index tensors (argmax, multinomial) come back as int64
+			const int64_t* data = tensor.data_ptr<int64_t>();
+			for (int64_t i = 0; i < size; i++)
+				out[i] = (T)data[i];
+		} else {
+			tensor = tensor.to(torch::CppTypeToScalarType<T>());
+			memcpy(out, tensor.data_ptr<T>(), size * sizeof(T));
+		}
+	}
+
 	template <typename T>
 	inline std::vector<T> TENSOR_TO_VEC(torch::Tensor tensor) {
 		assert(tensor.dim() == 1);
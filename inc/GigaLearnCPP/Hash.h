@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace GGL {
+
+	// FNV-1a, for fingerprinting weights and configs (not for anything adversarial)
+	constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+
+	inline void HashBytes(uint64_t& hash, const void* data, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001B3ull;
+		}
+	}
+
+	template <typename T>
+	inline void HashValue(uint64_t& hash, const T& value) {
+		HashBytes(hash, &value, sizeof(T));
+	}
+}
@@ -0,0 +1,251 @@
+#include "InferPlan.h"
+
+#include <GigaLearnCPP/Models.h>
+
+using namespace GGL;
+
+namespace {
+	Native::AlignedVec<float> TensorToAlignedVec(const torch::Tensor& tensor) {
+		auto t = tensor.detach().to(torch::kCPU, torch::kFloat).contiguous();
+		const float* data = t.data_ptr<float>();
+		return Native::AlignedVec<float>(data, data + t.numel());
+	}
+}
+
+void GGL::Native::Network::AppendModel(Model& model) {
+	int lastSize = layers.empty() ? model.config.numInputs : numOutputs;
+	if (layers.empty())
+		numInputs = lastSize;
+
+	for (auto& child : model.seq->children()) {
+		Layer layer = {};
+		layer.inSize = layer.outSize = lastSize;
+
+		if (auto linear = std::dynamic_pointer_cast<torch::nn::LinearImpl>(child)) {
+			layer.type = Layer::Type::LINEAR;
+			layer.inSize = (int)linear->weight.size(1);
+			layer.outSize = (int)linear->weight.size(0);
+			layer.weight = TensorToAlignedVec(linear->weight);
+			if (linear->bias.defined())
+				layer.bias = TensorToAlignedVec(linear->bias);
+
+			if (layer.inSize != lastSize) {
+				RG_ERR_CLOSE(
+					"Native::Network: Linear layer in \"" << model.modelName << "\" expects " << layer.inSize <<
+					" inputs, but the previous layer outputs " << lastSize
+				);
+			}
+
+		} else if (auto layerNorm = std::dynamic_pointer_cast<torch::nn::LayerNormImpl>(child)) {
+			layer.type = Layer::Type::LAYER_NORM;
+			layer.eps = (float)layerNorm->options.eps();
+			if (layerNorm->weight.defined()) {
+				layer.weight = TensorToAlignedVec(layerNorm->weight);
+				layer.bias = TensorToAlignedVec(layerNorm->bias);
+			} else {
+				layer.weight.assign(lastSize, 1.f);
+				layer.bias.assign(lastSize, 0.f);
+			}
+
+		} else {
+			layer.type = Layer::Type::ACTIVATION;
+			if (std::dynamic_pointer_cast<torch::nn::ReLUImpl>(child)) {
+				layer.activationType = ModelActivationType::RELU;
+			} else if (auto leakyReLU = std::dynamic_pointer_cast<torch::nn::LeakyReLUImpl>(child)) {
+				layer.activationType = ModelActivationType::LEAKY_RELU;
+				layer.negativeSlope = (float)leakyReLU->options.negative_slope();
+			} else if (std::dynamic_pointer_cast<torch::nn::SigmoidImpl>(child)) {
+				layer.activationType = ModelActivationType::SIGMOID;
+			} else if (std::dynamic_pointer_cast<torch::nn::TanhImpl>(child)) {
+				layer.activationType = ModelActivationType::TANH;
+			} else {
+				RG_ERR_CLOSE("Native::Network: Unsupported module \"" << child->name() << "\" in model \"" << model.modelName << "\"");
+			}
+		}
+
+		if (layers.empty() && layer.type != Layer::Type::LINEAR)
+			RG_ERR_CLOSE("Native::Network: First layer of \"" << model.modelName << "\" must be linear");
+
+		lastSize = layer.outSize;
+		layers.push_back(std::move(layer));
+	}
+
+	numOutputs = lastSize;
+}
+
+GGL::Native::InferPlan GGL::Native::InferPlan::Compile(const Network& network, bool bf16) {
+	InferPlan plan = {};
+	plan.numInputs = network.numInputs;
+	plan.numOutputs = network.numOutputs;
+	plan.bf16 = bf16;
+
+	// Reserve both arenas for everything allocated below (with worst-case alignment padding per allocation),
+	// so the weights aren't left with a reallocation's slack capacity
+	// Everything is addressed by offset, so this is only about memory, not correctness
+	constexpr size_t ALIGN_FLOATS = SIMD_ALIGN / sizeof(float), ALIGN_BF16 = SIMD_ALIGN / sizeof(uint16_t);
+	size_t arenaSize = 0, bf16ArenaSize = 0;
+	for (auto& layer : network.layers) {
+		int paddedOutSize = GetPanelPaddedSize(layer.outSize);
+		if (layer.type == Layer::Type::LINEAR) {
+			if (bf16) {
+				bf16ArenaSize += (size_t)paddedOutSize * GetBF16PaddedSize(layer.inSize) + ALIGN_BF16;
+			} else {
+				arenaSize += (size_t)paddedOutSize * layer.inSize + ALIGN_FLOATS;
+			}
+			arenaSize += paddedOutSize + ALIGN_FLOATS; // Bias
+		} else if (layer.type == Layer::Type::LAYER_NORM) {
+			arenaSize += ((size_t)layer.outSize + ALIGN_FLOATS) * 2;
+		}
+	}
+
+	// The sparse output copy below, made when the network ends on a bare linear layer
+	if (!network.layers.empty() && network.layers.back().type == Layer::Type::LINEAR)
+		arenaSize += (size_t)network.layers.back().outSize * network.layers.back().inSize + ALIGN_FLOATS;
+
+	plan.arena.reserve(arenaSize);
+	plan.bf16Weights.reserve(bf16ArenaSize);
+
+	auto& layers = network.layers;
+	const Layer* lastLinear = NULL;
+	for (size_t i = 0; i < layers.size();) {
+		auto& linear = layers[i];
+		lastLinear = &linear;
+		if (linear.type != Layer::Type::LINEAR)
+			RG_ERR_CLOSE("InferPlan::Compile(): Expected a linear layer at index " << i << ", got layer type " << (int)linear.type);
+		i++;
+
+		PlanOp op = {};
+		op.inSize = linear.inSize;
+		op.outSize = linear.outSize;
+		op.paddedOutSize = GetPanelPaddedSize(linear.outSize);
+
+		if (bf16) {
+			op.weightOffset = ArenaAlloc(plan.bf16Weights, (size_t)op.paddedOutSize * GetBF16PaddedSize(op.inSize));
+			PackBF16Panels(linear.weight.data(), op.inSize, op.outSize, plan.bf16Weights.data() + op.weightOffset);
+		} else {
+			op.weightOffset = ArenaAlloc(plan.arena, (size_t)op.paddedOutSize * op.inSize);
+			PackPanels(linear.weight.data(), op.inSize, op.outSize, plan.arena.data() + op.weightOffset);
+		}
+
+		op.biasOffset = ArenaAlloc(plan.arena, op.paddedOutSize);
+		if (!linear.bias.empty())
+			std::copy(linear.bias.begin(), linear.bias.end(), plan.arena.begin() + op.biasOffset);
+
+		if (i < layers.size() && layers[i].type == Layer::Type::LAYER_NORM) {
+			auto& layerNorm = layers[i];
+			op.hasLayerNorm = true;
+			op.eps = layerNorm.eps;
+			op.gammaOffset = ArenaAlloc(plan.arena, op.outSize);
+			std::copy(layerNorm.weight.begin(), layerNorm.weight.end(), plan.arena.begin() + op.gammaOffset);
+			op.betaOffset = ArenaAlloc(plan.arena, op.outSize);
+			std::copy(layerNorm.bias.begin(), layerNorm.bias.end(), plan.arena.begin() + op.betaOffset);
+			i++;
+		}
+
+		if (i < layers.size() && layers[i].type == Layer::Type::ACTIVATION) {
+			op.hasActivation = true;
+			op.activationType = layers[i].activationType;
+			op.negativeSlope = (op.activationType == ModelActivationType::LEAKY_RELU) ? layers[i].negativeSlope : 0;
+			i++;
+		}
+
+		plan.maxPaddedWidth = RS_MAX(plan.maxPaddedWidth, op.paddedOutSize);
+		plan.maxInSize = RS_MAX(plan.maxInSize, op.inSize);
+		plan.ops.push_back(op);
+	}
+
+	if (plan.ops.empty())
+		RG_ERR_CLOSE("InferPlan::Compile(): Network has no layers");
+
+	// Row-major copy of the output layer, so single logits can be evaluated without walking whole panels
+	auto& lastOp = plan.ops.back();
+	if (!lastOp.hasLayerNorm && !lastOp.hasActivation) {
+		plan.hasSparseOutput = true;
+		plan.sparseOutputWeightOffset = ArenaAlloc(plan.arena, (size_t)lastOp.outSize * lastOp.inSize);
+		std::copy(lastLinear->weight.begin(), lastLinear->weight.end(), plan.arena.begin() + plan.sparseOutputWeightOffset);
+	}
+
+	return plan;
+}
+
+const float* GGL::Native::InferPlan::RunOps(const float* in, int numRows, float* scratch, size_t numOps) const {
+	const float* cur = in;
+	int curStride = numInputs;
+
+	float* buffers[2] = { scratch, scratch + (size_t)numRows * maxPaddedWidth };
+	int nextBuffer = 0;
+
+	uint16_t* bf16In = (uint16_t*)(scratch + 2 * (size_t)numRows * maxPaddedWidth);
+	int bf16Stride = GetBF16PaddedSize(maxInSize);
+
+	const float* weights = arena.data();
+	for (size_t opIdx = 0; opIdx < numOps; opIdx++) {
+		auto& op = ops[opIdx];
+		float* out = buffers[nextBuffer];
+		nextBuffer ^= 1;
+
+		bool fuseAct = op.CanFuseActivation();
+
+		// Without a LayerNorm in between, the activation goes straight into the linear kernel
+		if (bf16) {
+			for (int r = 0; r < numRows; r++)
+				ConvertToBF16(cur + (size_t)r * curStride, op.inSize, bf16Stride, bf16In + (size_t)r * bf16Stride);
+
+			BF16PanelLinear(
+				bf16In, bf16Stride, out, op.paddedOutSize, numRows,
+				bf16Weights.data() + op.weightOffset, weights + op.biasOffset, op.inSize, op.paddedOutSize,
+				fuseAct && !op.hasLayerNorm, op.negativeSlope
+			);
+		} else {
+			PanelLinear(
+				cur, curStride, out, op.paddedOutSize, numRows,
+				weights + op.weightOffset, weights + op.biasOffset, op.inSize, op.paddedOutSize,
+				fuseAct && !op.hasLayerNorm, op.negativeSlope
+			);
+		}
+
+		for (int r = 0; r < numRows; r++) {
+			float* row = out + (size_t)r * op.paddedOutSize;
+			if (op.hasLayerNorm)
+				LayerNorm(row, weights + op.gammaOffset, weights + op.betaOffset, op.outSize, op.eps, fuseAct, op.negativeSlope);
+
+			if (op.hasActivation && !fuseAct)
+				Activation(row, op.outSize, op.activationType, op.negativeSlope);
+		}
+
+		cur = out;
+		curStride = op.paddedOutSize;
+	}
+
+	return cur;
+}
+
+const float* GGL::Native::InferPlan::Forward(const float* in, int numRows, float* scratch) const {
+	return RunOps(in, numRows, scratch, ops.size());
+}
+
+const float* GGL::Native::InferPlan::ForwardSparse(const float* in, int numRows, const uint8_t* actionMasks, float* scratch) const {
+	RG_ASSERT(hasSparseOutput);
+
+	// The output op writes into whichever ping-pong buffer RunOps() would have used next
+	const float* hidden = RunOps(in, numRows, scratch, ops.size() - 1);
+	int hiddenStride = (ops.size() > 1) ? ops[ops.size() - 2].paddedOutSize : numInputs;
+	float* out = scratch + ((ops.size() - 1) % 2) * (size_t)numRows * maxPaddedWidth;
+
+	auto& op = ops.back();
+	int* rows = (int*)(scratch + GetScratchSize(numRows) - numOutputs);
+	for (int r = 0; r < numRows; r++) {
+		const uint8_t* mask = actionMasks + (size_t)r * numOutputs;
+		int numEnabled = 0;
+		for (int i = 0; i < numOutputs; i++)
+			if (mask[i])
+				rows[numEnabled++] = i;
+
+		SparseLinear(
+			hidden + (size_t)r * hiddenStride, arena.data() + sparseOutputWeightOffset, arena.data() + op.biasOffset,
+			out + (size_t)r * op.paddedOutSize, op.inSize, rows, numEnabled
+		);
+	}
+
+	return out;
+}
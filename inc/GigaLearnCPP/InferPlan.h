@@ -0,0 +1,107 @@
+#pragma once
+
+#include "NativeKernels.h"
+
+namespace GGL {
+
+	class Model;
+
+	namespace Native {
+		struct Layer {
+			enum class Type {
+				LINEAR,
+				LAYER_NORM,
+				ACTIVATION
+			};
+
+			Type type;
+			int inSize = 0, outSize = 0;
+
+			// LINEAR: weight is [outSize, inSize]
+			// LAYER_NORM: weight/bias are gamma/beta
+			AlignedVec<float> weight, bias;
+			float eps = 1e-5f;
+
+			ModelActivationType activationType = ModelActivationType::RELU;
+			float negativeSlope = 0.01f;
+		};
+
+		// Flattened fp32 copy of one or more loaded torch Sequentials, layer by layer
+		struct Network {
+			std::vector<Layer> layers;
+			int numInputs = 0, numOutputs = 0;
+
+			// Appends the layers of a loaded model, its input size must match the current output size
+			void AppendModel(Model& model);
+		};
+
+		// One fused Linear -> [LayerNorm] -> [Activation] step of an InferPlan
+		struct PlanOp {
+			int inSize, outSize, paddedOutSize;
+
+			// Offsets into InferPlan::arena (weightOffset is into InferPlan::bf16Weights for bf16 plans)
+			size_t weightOffset, biasOffset;
+			size_t gammaOffset = 0, betaOffset = 0;
+
+			bool hasLayerNorm = false;
+			float eps = 1e-5f;
+
+			bool hasActivation = false;
+			ModelActivationType activationType = ModelActivationType::RELU;
+			float negativeSlope = 0;
+
+			// ReLU and LeakyReLU are folded into the last pass of the previous kernel
+			bool CanFuseActivation() const {
+				return hasActivation &&
+					(activationType == ModelActivationType::RELU || (activationType == ModelActivationType::LEAKY_RELU && negativeSlope <= 1));
+			}
+		};
+
+		// Inference-only execution plan compiled from a Network
+		// All weights live in one aligned arena, with linear weights packed into panels (see PackPanels())
+		// bf16 plans keep the linear weights in bf16Weights instead (see PackBF16Panels()), everything else stays fp32
+		struct InferPlan {
+			std::vector<PlanOp> ops;
+			AlignedVec<float> arena;
+			AlignedVec<uint16_t> bf16Weights;
+			bool bf16 = false;
+			int numInputs = 0, numOutputs = 0;
+			int maxPaddedWidth = 0, maxInSize = 0;
+
+			// Set if the output op is a plain linear, which ForwardSparse() then evaluates row by row
+			bool hasSparseOutput = false;
+			size_t sparseOutputWeightOffset = 0; // Row-major [numOutputs, inSize] copy in the arena
+
+			static InferPlan Compile(const Network& network, bool bf16 = false);
+
+			size_t GetScratchSize(int numRows) const {
+				size_t size = 2 * (size_t)numRows * maxPaddedWidth;
+				if (bf16)
+					size += (size_t)numRows * GetBF16PaddedSize(maxInSize) / 2; // bf16 copy of each op's input
+				if (hasSparseOutput)
+					size += numOutputs; // Enabled output indices
+				return size;
+			}
+
+			size_t GetWeightBytes() const {
+				return arena.size() * sizeof(float) + bf16Weights.size() * sizeof(uint16_t);
+			}
+
+			// Row stride of the output returned by Forward()
+			int GetOutputStride() const {
+				return ops.back().paddedOutSize;
+			}
+
+			// in is [numRows, numInputs], scratch needs GetScratchSize(numRows) floats
+			// Returns the output rows (see GetOutputStride()), which live inside scratch
+			const float* Forward(const float* in, int numRows, float* scratch) const;
+
+			// Same as Forward(), but only the outputs enabled in actionMasks ([numRows, numOutputs]) are computed
+			// The other outputs are left as garbage, so only use this for masked selection
+			const float* ForwardSparse(const float* in, int numRows, const uint8_t* actionMasks, float* scratch) const;
+
+		private:
+			const float* RunOps(const float* in, int numRows, float* scratch, size_t numOps) const;
+		};
+	}
+}
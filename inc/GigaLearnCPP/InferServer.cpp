@@ -0,0 +1,464 @@
+#include "InferServer.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef GGL_NO_TORCH
+#include <GigaLearnCPP/FrameworkTorch.h>
+#endif
+
+namespace {
+	// Per stat, past this only the counters keep updating until the next TakeStats()
+	constexpr size_t MAX_LATENCY_SAMPLES = 1 << 20;
+
+	// An idle server spins this many times before it starts sleeping between polls
+	constexpr int IDLE_SPINS = 4096;
+	constexpr auto IDLE_SLEEP = std::chrono::microseconds(50);
+
+#ifdef _WIN32
+	std::string GetMappingName(const std::string& name) {
+		return "Local\\" + name; // Per login session, like the bots
+	}
+#else
+	std::string GetMappingName(const std::string& name) {
+		return "/" + name;
+	}
+#endif
+}
+
+uint64_t GGL::InferShm::GetNowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::unique_ptr<GGL::SharedMemory> GGL::SharedMemory::Create(const std::string& name, size_t size) {
+	std::unique_ptr<SharedMemory> result(new SharedMemory());
+	result->_name = GetMappingName(name);
+	result->_size = size;
+	result->_owner = true;
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileMappingA(
+		INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, result->_name.c_str()
+	);
+	if (!handle)
+		RG_ERR_CLOSE("SharedMemory: Failed to create \"" << result->_name << "\" (error " << GetLastError() << ")");
+	if (GetLastError() == ERROR_ALREADY_EXISTS) {
+		// Mappings only go away once every process closes them, e.g. clients of a crashed server until they notice
+		CloseHandle(handle);
+		RG_ERR_CLOSE("SharedMemory: \"" << result->_name << "\" is still open in another process");
+	}
+
+	result->_handle = handle;
+	result->_data = (uint8_t*)MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!result->_data)
+		RG_ERR_CLOSE("SharedMemory: Failed to map \"" << result->_name << "\" (error " << GetLastError() << ")");
+#else
+	// Segments outlive their processes on POSIX, so one left behind by a crash is replaced
+	shm_unlink(result->_name.c_str());
+
+	int fd = shm_open(result->_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		RG_ERR_CLOSE("SharedMemory: Failed to create \"" << result->_name << "\": " << strerror(errno));
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		int error = errno;
+		close(fd);
+		shm_unlink(result->_name.c_str());
+		RG_ERR_CLOSE("SharedMemory: Failed to size \"" << result->_name << "\" to " << size << " bytes: " << strerror(error));
+	}
+
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		shm_unlink(result->_name.c_str());
+		RG_ERR_CLOSE("SharedMemory: Failed to map \"" << result->_name << "\": " << strerror(errno));
+	}
+	result->_data = (uint8_t*)data;
+#endif
+
+	return result;
+}
+
+std::unique_ptr<GGL::SharedMemory> GGL::SharedMemory::Open(const std::string& name) {
+	std::unique_ptr<SharedMemory> result(new SharedMemory());
+	result->_name = GetMappingName(name);
+
+#ifdef _WIN32
+	HANDLE handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, result->_name.c_str());
+	if (!handle)
+		return NULL;
+
+	result->_handle = handle;
+	result->_data = (uint8_t*)MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (!result->_data)
+		return NULL;
+
+	MEMORY_BASIC_INFORMATION info = {};
+	VirtualQuery(result->_data, &info, sizeof(info));
+	result->_size = info.RegionSize;
+#else
+	int fd = shm_open(result->_name.c_str(), O_RDWR, 0);
+	if (fd < 0)
+		return NULL;
+
+	struct stat fileStat = {};
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	result->_data = (uint8_t*)data;
+	result->_size = (size_t)fileStat.st_size;
+#endif
+
+	return result;
+}
+
+GGL::SharedMemory::~SharedMemory() {
+#ifdef _WIN32
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_handle)
+		CloseHandle((HANDLE)_handle);
+#else
+	if (_data)
+		munmap(_data, _size);
+	if (_owner)
+		shm_unlink(_name.c_str());
+#endif
+}
+
+uint64_t GGL::GetBackendFingerprint(InferenceBackend& backend) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	HashValue(hash, backend.obsSize);
+	HashValue(hash, backend.numActions);
+
+	auto regions = backend.GetWeightRegions();
+	for (auto& region : regions)
+		HashBytes(hash, region.data, region.bytes);
+
+	if (regions.empty()) {
+		// Different weights are all but certain to disagree somewhere over enough random obs
+		constexpr int NUM_PROBES = 64;
+		std::vector<float> obs((size_t)NUM_PROBES * backend.obsSize);
+		std::vector<uint8_t> masks((size_t)NUM_PROBES * backend.numActions, 1);
+		std::vector<int> actions(NUM_PROBES);
+
+		FastRNG rng(0);
+		for (float& val : obs)
+			val = rng.NextFloat() * 2 - 1;
+
+		backend.InferActions(obs.data(), masks.data(), NUM_PROBES, true, 1, actions.data(), NULL, NULL);
+		HashBytes(hash, actions.data(), actions.size() * sizeof(int));
+	}
+
+	return hash;
+}
+
+GGL::InferLatencyStats GGL::MakeInferLatencyStats(std::vector<float>& samples) {
+	InferLatencyStats stats = {};
+	stats.numSamples = samples.size();
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0;
+	for (float sample : samples)
+		total += sample;
+	stats.meanUs = total / samples.size();
+
+	// Nearest-rank
+	auto getPercentile = [&](double fraction) {
+		size_t index = (size_t)(fraction * (samples.size() - 1) + 0.5);
+		return (double)samples[index];
+	};
+	stats.p50Us = getPercentile(0.50);
+	stats.p90Us = getPercentile(0.90);
+	stats.p99Us = getPercentile(0.99);
+	stats.maxUs = samples.back();
+	return stats;
+}
+
+GGL::InferServer::InferServer(InferenceBackend& backend, const InferServerConfig& config) :
+	config(config), _backend(backend) {
+
+	using namespace InferShm;
+
+	RG_ASSERT(config.maxBatchSize > 0 && config.numSlots > 0);
+
+	std::string segmentName = GetSegmentName(config.name);
+
+	// Don't take the name over from a server that's still running
+	if (auto existing = SharedMemory::Open(segmentName)) {
+		auto existingHeader = (Header*)existing->GetData();
+		if (existing->GetSize() >= sizeof(Header) && existingHeader->magic == MAGIC &&
+			GetNowNs() - existingHeader->heartbeatNs.load() < SERVER_STALE_NS) {
+			RG_ERR_CLOSE("InferServer: A server named \"" << config.name << "\" is already running");
+		}
+	}
+
+	uint64_t fingerprint = GetBackendFingerprint(backend);
+
+	_memory = SharedMemory::Create(segmentName, GetSegmentSize(backend.obsSize, backend.numActions, config.numSlots));
+	_header = new (_memory->GetData()) Header();
+	_header->version = VERSION;
+	_header->obsSize = backend.obsSize;
+	_header->numActions = backend.numActions;
+	_header->numSlots = config.numSlots;
+	_header->slotStride = GetSlotStride(backend.obsSize, backend.numActions);
+	_header->fingerprint = fingerprint;
+	_header->heartbeatNs = GetNowNs();
+	_header->nextSlot = 0;
+
+	for (int i = 0; i < config.numSlots; i++)
+		new (GetSlot(_header, i)) Slot();
+
+	// Published last, clients ignore the segment until the magic is there
+	std::atomic_thread_fence(std::memory_order_release);
+	_header->magic = MAGIC;
+
+	_deadSlotRequestNs.resize(config.numSlots);
+	_batchSlots.reserve(config.maxBatchSize);
+	_served.resize(config.maxBatchSize);
+	_obs.resize((size_t)config.maxBatchSize * backend.obsSize);
+	_masks.resize((size_t)config.maxBatchSize * backend.numActions);
+	_actions.resize(config.maxBatchSize);
+	_subBatchRows.resize(config.maxBatchSize);
+	_logProbs.resize(config.maxBatchSize);
+	_rngs.resize(config.maxBatchSize);
+	_stats.batchSizeCounts.resize(config.maxBatchSize);
+
+	RG_LOG(
+		"InferServer: Serving " << backend.GetName() << " backend as \"" << config.name << "\" (" << config.numSlots << " slots, " <<
+		"batch window " << config.batchWindowUs << "us, max batch " << config.maxBatchSize << ", fingerprint " << std::hex << fingerprint << std::dec << ")"
+	);
+}
+
+void GGL::InferServer::CollectRequests() {
+	using namespace InferShm;
+
+	for (int i = 0; i < _header->numSlots && (int)_batchSlots.size() < config.maxBatchSize; i++) {
+		Slot* slot = GetSlot(_header, i);
+		uint32_t expected = SLOT_REQUESTED;
+		if (slot->state.load(std::memory_order_relaxed) == SLOT_REQUESTED &&
+			slot->state.compare_exchange_strong(expected, SLOT_SERVING, std::memory_order_acquire)) {
+			_batchSlots.push_back(slot);
+		}
+	}
+}
+
+void GGL::InferServer::ServeBatch() {
+	using namespace InferShm;
+	using Clock = std::chrono::steady_clock;
+
+	int obsSize = _backend.obsSize, numActions = _backend.numActions;
+	int batchSize = (int)_batchSlots.size();
+	uint64_t servingNs = GetNowNs();
+
+	std::fill(_served.begin(), _served.begin() + batchSize, 0);
+
+	// Rows can only share an InferActions() call if they agree on the sampling mode, which is almost always the case
+	for (int first = 0; first < batchSize; first++) {
+		if (_served[first])
+			continue;
+
+		bool deterministic = _batchSlots[first]->deterministic;
+		float temperature = _batchSlots[first]->temperature;
+
+		int numRows = 0;
+		for (int i = first; i < batchSize; i++) {
+			Slot* slot = _batchSlots[i];
+			if (_served[i] || (bool)slot->deterministic != deterministic || slot->temperature != temperature)
+				continue;
+
+			memcpy(_obs.data() + (size_t)numRows * obsSize, GetSlotObs(slot), obsSize * sizeof(float));
+			memcpy(_masks.data() + (size_t)numRows * numActions, GetSlotMask(slot, obsSize), numActions);
+			memcpy(_rngs[numRows].state, slot->rngState, sizeof(slot->rngState));
+			_served[i] = true;
+			_subBatchRows[numRows++] = i;
+		}
+
+		// Deterministic actions have no log-prob, report 0 (probability 1)
+		std::fill(_logProbs.begin(), _logProbs.begin() + numRows, 0.f);
+
+		auto inferStartTime = Clock::now();
+		_backend.InferActions(
+			_obs.data(), _masks.data(), numRows, deterministic, temperature, _actions.data(), _logProbs.data(), _rngs.data()
+		);
+		float inferenceUs = std::chrono::duration<float, std::micro>(Clock::now() - inferStartTime).count();
+		if (_inferenceUs.size() < MAX_LATENCY_SAMPLES)
+			_inferenceUs.push_back(inferenceUs);
+
+		uint64_t doneNs = GetNowNs();
+		for (int j = 0; j < numRows; j++) {
+			Slot* slot = _batchSlots[_subBatchRows[j]];
+			slot->action = _actions[j];
+			slot->logProb = _logProbs[j];
+			memcpy(slot->rngState, _rngs[j].state, sizeof(slot->rngState));
+
+			if (_totalUs.size() < MAX_LATENCY_SAMPLES) {
+				uint64_t requestNs = slot->requestNs.load(std::memory_order_relaxed);
+				_queueUs.push_back((servingNs - RS_MIN(requestNs, servingNs)) / 1000.f);
+				_totalUs.push_back((doneNs - RS_MIN(requestNs, doneNs)) / 1000.f);
+			}
+
+			uint32_t expected = SLOT_SERVING;
+			if (!slot->state.compare_exchange_strong(expected, SLOT_DONE, std::memory_order_release)) {
+				// The client timed out and fell back to its own backend
+				slot->state.store(SLOT_FREE, std::memory_order_release);
+				_stats.numAbandoned++;
+			}
+		}
+	}
+
+	_stats.numBatches++;
+	_stats.numRows += batchSize;
+	_stats.batchSizeCounts[batchSize - 1]++;
+	_batchSlots.clear();
+}
+
+void GGL::InferServer::ReclaimDeadSlots() {
+	using namespace InferShm;
+
+	uint64_t nowNs = GetNowNs();
+	uint64_t staleNs = (uint64_t)RS_MAX(config.reclaimSlotMs, 1) * 1'000'000;
+
+	for (int i = 0; i < _header->numSlots; i++) {
+		Slot* slot = GetSlot(_header, i);
+		uint32_t state = slot->state.load(std::memory_order_acquire);
+		uint64_t requestNs = slot->requestNs.load(std::memory_order_relaxed);
+
+		bool looksDead = (state == SLOT_WRITING || state == SLOT_DONE) && nowNs - RS_MIN(requestNs, nowNs) > staleNs;
+		if (!looksDead) {
+			_deadSlotRequestNs[i] = 0;
+			continue;
+		}
+
+		// A client that just claimed the slot may not have written its requestNs yet, so only a second scan
+		// finding the same requestNs proves nobody touched the slot in between
+		if (_deadSlotRequestNs[i] != requestNs) {
+			_deadSlotRequestNs[i] = requestNs;
+			continue;
+		}
+
+		uint32_t expected = state;
+		if (slot->state.compare_exchange_strong(expected, SLOT_FREE, std::memory_order_release))
+			_stats.numReclaimed++;
+		_deadSlotRequestNs[i] = 0;
+	}
+}
+
+void GGL::InferServer::Run(const std::atomic<bool>& stop) {
+#ifndef GGL_NO_TORCH
+	RG_NO_GRAD;
+#endif
+
+	using namespace InferShm;
+	using Clock = std::chrono::steady_clock;
+
+	auto lastStatsTime = Clock::now(), lastReclaimTime = Clock::now();
+	auto reclaimInterval = std::chrono::milliseconds(RS_MAX(config.reclaimSlotMs, 1));
+	int numIdleSpins = 0;
+
+	while (!stop) {
+		_header->heartbeatNs.store(GetNowNs(), std::memory_order_relaxed);
+
+		if (config.statsIntervalSeconds > 0 &&
+			std::chrono::duration<float>(Clock::now() - lastStatsTime).count() >= config.statsIntervalSeconds) {
+			auto stats = TakeStats();
+			if (stats.numBatches > 0 || stats.numReclaimed > 0)
+				LogStats(stats);
+			lastStatsTime = Clock::now();
+		}
+
+		if (Clock::now() - lastReclaimTime >= reclaimInterval) {
+			ReclaimDeadSlots();
+			lastReclaimTime = Clock::now();
+		}
+
+		CollectRequests();
+		if (_batchSlots.empty()) {
+			// Stay responsive right after a burst, but don't hold a core while the bots are idle (e.g. between matches)
+			if (++numIdleSpins < IDLE_SPINS) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(IDLE_SLEEP);
+			}
+			continue;
+		}
+		numIdleSpins = 0;
+
+		// Give the other bots' requests for this tick a chance to join the batch
+		auto windowEndTime = Clock::now() + std::chrono::microseconds(config.batchWindowUs);
+		while ((int)_batchSlots.size() < config.maxBatchSize && Clock::now() < windowEndTime) {
+			std::this_thread::yield();
+			CollectRequests();
+		}
+
+		ServeBatch();
+	}
+
+	// Tell clients right away instead of letting them wait out the heartbeat
+	_header->heartbeatNs.store(0);
+}
+
+GGL::InferServerStats GGL::InferServer::TakeStats() {
+	InferServerStats stats = _stats;
+	stats.queue = MakeInferLatencyStats(_queueUs);
+	stats.inference = MakeInferLatencyStats(_inferenceUs);
+	stats.total = MakeInferLatencyStats(_totalUs);
+
+	_stats = {};
+	_stats.batchSizeCounts.resize(config.maxBatchSize);
+	_queueUs.clear();
+	_inferenceUs.clear();
+	_totalUs.clear();
+	return stats;
+}
+
+void GGL::InferServer::LogStats(const InferServerStats& stats) {
+	auto formatLatency = [](const InferLatencyStats& latency) {
+		std::stringstream stream;
+		stream <<
+			"mean " << latency.meanUs << "us, p50 " << latency.p50Us << "us, p90 " << latency.p90Us <<
+			"us, p99 " << latency.p99Us << "us, max " << latency.maxUs << "us";
+		return stream.str();
+	};
+
+	std::stringstream batchSizes;
+	for (int i = 0; i < (int)stats.batchSizeCounts.size(); i++)
+		if (stats.batchSizeCounts[i] > 0)
+			batchSizes << (batchSizes.tellp() > 0 ? ", " : "") << (i + 1) << ": " << stats.batchSizeCounts[i];
+
+	RG_LOG(
+		"InferServer: " << stats.numRows << " rows in " << stats.numBatches << " batches (mean batch size " <<
+		((double)stats.numRows / RS_MAX(stats.numBatches, 1ull)) << ", " << stats.numAbandoned << " abandoned by their client, " <<
+		stats.numReclaimed << " slots reclaimed from dead clients)"
+	);
+	RG_LOG("InferServer:  Batch sizes: " << batchSizes.str());
+	RG_LOG("InferServer:  Queue wait: " << formatLatency(stats.queue));
+	RG_LOG("InferServer:  Inference per batch: " << formatLatency(stats.inference));
+	RG_LOG("InferServer:  Total per row: " << formatLatency(stats.total));
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <GigaLearnCPP/InferenceBackend.h>
+#include <GigaLearnCPP/NativeKernels.h>
+#include <atomic>
+#include <string>
+
+namespace GGL {
+
+	// A named block of memory shared between processes on this machine
+	class SharedMemory {
+	public:
+		~SharedMemory();
+		RG_NO_COPY(SharedMemory);
+
+		// Throws if the segment can't be created, any stale segment left under the name by a crashed process is replaced
+		static std::unique_ptr<SharedMemory> Create(const std::string& name, size_t size);
+
+		// NULL if there is no segment with that name
+		static std::unique_ptr<SharedMemory> Open(const std::string& name);
+
+		uint8_t* GetData() const { return _data; }
+		size_t GetSize() const { return _size; }
+
+	private:
+		SharedMemory() = default;
+
+		std::string _name;
+		uint8_t* _data = NULL;
+		size_t _size = 0;
+		bool _owner = false;
+		void* _handle = NULL; // Windows only
+	};
+
+	// Layout of the segment an InferServer shares with its clients (see RemoteInferenceBackend)
+	// A header, then numSlots fixed-size slots that each carry one row: the request (obs, mask, sampling state) and its result
+	namespace InferShm {
+		constexpr uint64_t MAGIC = 0x52464E494C4747ull; // "GGLINFR"
+		constexpr uint32_t VERSION = 2;
+
+		// Each slot's state moves FREE -> WRITING -> REQUESTED -> SERVING -> DONE -> FREE
+		// A client that times out frees a REQUESTED slot itself, or marks a SERVING one ABANDONED for the server to free
+		// Slots left WRITING or DONE by a client that died are freed by the server (see InferServerConfig::reclaimSlotMs)
+		enum SlotState : uint32_t {
+			SLOT_FREE,
+			SLOT_WRITING,   // Claimed by a client that's filling it
+			SLOT_REQUESTED, // Waiting for the server
+			SLOT_SERVING,   // Taken into a batch
+			SLOT_DONE,      // Result written, the client reads it and frees the slot
+			SLOT_ABANDONED
+		};
+
+		// Both processes operate on these atomics in place, so they can't fall back to locks
+		static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free);
+
+		struct alignas(64) Header {
+			uint64_t magic;
+			uint32_t version;
+			int32_t obsSize, numActions, numSlots;
+			uint64_t slotStride;
+			uint64_t fingerprint; // See GetBackendFingerprint(), clients only use a server running the same model
+
+			std::atomic<uint64_t> heartbeatNs; // Bumped by the server loop, see GetNowNs()
+			std::atomic<uint32_t> nextSlot;    // Where the next client starts looking for free slots
+		};
+
+		struct alignas(64) Slot {
+			std::atomic<uint32_t> state;
+			uint32_t deterministic;
+			float temperature;
+			int32_t action;
+			float logProb;
+			uint64_t rngState[2]; // The row's FastRNG, written back advanced so sampling stays reproducible
+			std::atomic<uint64_t> requestNs; // Set when claimed, and again when requested
+			// Followed by the obs (obsSize floats) and the action mask (numActions bytes)
+		};
+
+		inline size_t GetSlotStride(int obsSize, int numActions) {
+			size_t size = sizeof(Slot) + (size_t)obsSize * sizeof(float) + numActions;
+			return (size + 63) / 64 * 64;
+		}
+
+		inline size_t GetSegmentSize(int obsSize, int numActions, int numSlots) {
+			return sizeof(Header) + GetSlotStride(obsSize, numActions) * numSlots;
+		}
+
+		inline Slot* GetSlot(Header* header, int index) {
+			return (Slot*)((uint8_t*)header + sizeof(Header) + header->slotStride * index);
+		}
+
+		inline float* GetSlotObs(Slot* slot) {
+			return (float*)(slot + 1);
+		}
+
+		inline uint8_t* GetSlotMask(Slot* slot, int obsSize) {
+			return (uint8_t*)(GetSlotObs(slot) + obsSize);
+		}
+
+		// A server whose heartbeat is older than this is considered gone
+		constexpr uint64_t SERVER_STALE_NS = 1'000'000'000ull;
+
+		// Steady clock, which is system-wide (CLOCK_MONOTONIC/QPC), so timestamps compare across processes
+		uint64_t GetNowNs();
+
+		// Name of the shared memory segment for a server name
+		inline std::string GetSegmentName(const std::string& serverName) {
+			return "GGLInfer_" + serverName;
+		}
+	}
+
+	// Identifies the model a backend runs, so clients never use a server with different weights
+	// Hashes the weights, or if the backend doesn't expose them (e.g. on the GPU), its actions on fixed probe obs
+	uint64_t GetBackendFingerprint(InferenceBackend& backend);
+
+	struct InferLatencyStats {
+		uint64_t numSamples = 0;
+		double meanUs = 0, p50Us = 0, p90Us = 0, p99Us = 0, maxUs = 0;
+	};
+
+	// Sorts samples
+	InferLatencyStats MakeInferLatencyStats(std::vector<float>& samples);
+
+	struct InferServerConfig {
+		// Clients connect with the same name (see InferUnitConfig::inferServerName)
+		std::string name = "GGLBot";
+
+		// After the first request of a batch, wait this long for other clients' requests to batch with it
+		// Longer windows give bigger batches, but every request in the batch pays for the wait
+		int batchWindowUs = 150;
+
+		int maxBatchSize = 64;
+		int numSlots = 256; // Rows that can be in flight at once across all clients
+
+		// Stats are logged and reset this often, 0 never logs them
+		float statsIntervalSeconds = 30;
+
+		// A slot stuck in WRITING or DONE for this long belongs to a client that died (e.g. killed at the end of a match),
+		// and is freed so the server doesn't run out of slots over a long session
+		// Has to be well above the clients' InferUnitConfig::inferServerTimeoutUs, a live client never holds a slot that long
+		int reclaimSlotMs = 250;
+	};
+
+	struct InferServerStats {
+		uint64_t numBatches = 0, numRows = 0;
+		uint64_t numAbandoned = 0; // Rows whose client gave up before the result was written
+		uint64_t numReclaimed = 0; // Slots freed after their client died holding them
+		std::vector<uint64_t> batchSizeCounts; // Index 0 is batches of 1 row
+
+		InferLatencyStats queue;     // Request written -> its batch closed, includes the batch window
+		InferLatencyStats inference; // Per batch, the backend call alone
+		InferLatencyStats total;     // Request written -> result written
+	};
+
+	// Serves a backend to RemoteInferenceBackend clients in other processes through shared memory
+	// Requests arriving within config.batchWindowUs of each other are inferred as one batch, which uses the SIMD width
+	// and cache far better than every bot process running batch-1 inference on its own
+	class InferServer {
+	public:
+		InferServerConfig config;
+
+		// The backend is not owned, and must not be used by anything else while Run() is going
+		InferServer(InferenceBackend& backend, const InferServerConfig& config);
+		RG_NO_COPY(InferServer);
+
+		// Serves requests until stop is set
+		void Run(const std::atomic<bool>& stop);
+
+		// Returns the stats since the last call and resets them
+		InferServerStats TakeStats();
+		void LogStats(const InferServerStats& stats);
+
+	private:
+		InferenceBackend& _backend;
+		std::unique_ptr<SharedMemory> _memory;
+		InferShm::Header* _header;
+
+		// Slots of the batch being collected, in arrival order
+		std::vector<InferShm::Slot*> _batchSlots;
+		std::vector<uint8_t> _served;
+
+		// One sub-batch (rows sharing deterministic and temperature) at a time
+		Native::AlignedVec<float> _obs;
+		Native::AlignedVec<uint8_t> _masks;
+		std::vector<int> _actions, _subBatchRows;
+		std::vector<float> _logProbs;
+		std::vector<FastRNG> _rngs;
+
+		InferServerStats _stats;
+		std::vector<float> _queueUs, _inferenceUs, _totalUs;
+
+		// requestNs of each slot that looked dead on the last ReclaimDeadSlots() scan, 0 for the others
+		std::vector<uint64_t> _deadSlotRequestNs;
+
+		// Moves requested slots into _batchSlots (up to config.maxBatchSize)
+		void CollectRequests();
+		void ServeBatch();
+
+		// Frees slots that stayed WRITING or DONE with the same stale requestNs across two scans
+		void ReclaimDeadSlots();
+	};
+}
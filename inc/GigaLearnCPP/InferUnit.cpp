@@ -1,13 +1,41 @@
 #include "InferUnit.h"
 
+#include <GigaLearnCPP/ObsRecording.h>
+#include <GigaLearnCPP/ShadowEvaluator.h>
+#include <GigaLearnCPP/MemoryUsage.h>
+#include <GigaLearnCPP/RemoteBackend.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+
+#ifndef GGL_NO_TORCH
 #include <GigaLearnCPP/Models.h>
 #include <GigaLearnCPP/InferenceModels.h>
+#include <GigaLearnCPP/NativeBackend.h>
+#include <ATen/Parallel.h>
+#endif
 
+#ifndef GGL_NO_TORCH
 GGL::InferUnit::InferUnit(
 	RLGC::ObsBuilder* obsBuilder, int obsSize, RLGC::ActionParser* actionParser,
 	InferPartialModelConfig sharedHeadConfig, InferPartialModelConfig policyConfig,
-	std::filesystem::path modelsFolder, bool useGPU) :
-	obsBuilder(obsBuilder), obsSize(obsSize), actionParser(actionParser), useGPU(useGPU) {
+	std::filesystem::path modelsFolder, bool useGPU, const InferUnitConfig& config) :
+	obsBuilder(obsBuilder), obsSize(obsSize), actionParser(actionParser), useGPU(useGPU), config(config),
+	_sharedHeadConfig(sharedHeadConfig), _policyConfig(policyConfig), _modelsFolder(modelsFolder) {
+
+	auto loadStartTime = std::chrono::steady_clock::now();
+
+	if (config.interOpThreads > 0) {
+		try {
+			at::set_num_interop_threads(config.interOpThreads);
+		}
+		catch (std::exception& e) {
+			// Only allowed before libtorch starts its inter-op pool (e.g. a second InferUnit)
+			RG_LOG("InferUnit: Couldn't set libtorch inter-op threads to " << config.interOpThreads << ", keeping " << at::get_num_interop_threads());
+		}
+	}
 
 	this->models = std::make_unique<ModelSet>();
 
@@ -31,78 +59,940 @@ GGL::InferUnit::InferUnit(
 	catch (std::exception& e) {
 		RG_ERR_CLOSE("InferUnit: Exception when trying to load models: " << e.what());
 	}
+
+	// Captured now, since leanMemory may free the models
+	for (auto& pair : models->map) {
+		_watchedFileNames.push_back(pair.second->GetSavePath(_modelsFolder).filename().string());
+		_watchedFileNames.push_back(pair.second->GetFlatSavePath(_modelsFolder).filename().string());
+	}
+
+	if (config.profileLayers) {
+		if (config.backend == InferBackendType::TORCH) {
+			this->models->EnableProfiling();
+		} else {
+			RG_LOG("InferUnit: profileLayers only works with the TORCH backend, not profiling");
+		}
+	}
+
+	try {
+		int numActions = actionParser->GetActionAmount();
+		this->backend = MakeInferenceBackend(config.backend, *this->models, obsSize, numActions, useGPU, config.precision);
+
+		if (config.checkParity && config.backend != InferBackendType::TORCH) {
+			auto torchBackend = MakeInferenceBackend(InferBackendType::TORCH, *this->models, obsSize, numActions, useGPU);
+			float maxDiff = CompareBackendLogits(*backend, *torchBackend);
+			RG_LOG("InferUnit: Max logit difference between " << backend->GetName() << " and libtorch: " << maxDiff);
+		}
+	}
+	catch (std::exception& e) {
+		RG_ERR_CLOSE("InferUnit: Exception when trying to create inference backend: " << e.what());
+	}
+
+	ConfigureBackend(*backend);
+
+	if (config.leanMemory) {
+		if (!backend->NeedsModels()) {
+			models.reset();
+			RG_LOG("InferUnit: Lean memory mode, freed the models (" << backend->GetName() << " has its own copy of the weights)");
+		}
+		ReleaseFreeMemory();
+	}
+
+	loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStartTime).count();
+
+	InitCommon();
+
+	if (config.shadowEnabled) {
+		auto shadowFolder = config.shadowModelsFolder.empty() ? modelsFolder : config.shadowModelsFolder;
+		try {
+			_shadowModels = std::make_unique<ModelSet>();
+			GGL::Infer::MakeInferenceModels(
+				obsSize, actionParser->GetActionAmount(), sharedHeadConfig, policyConfig,
+				useGPU ? torch::kCUDA : torch::kCPU, *_shadowModels
+			);
+			_shadowModels->Load(shadowFolder, false, false);
+
+			auto shadowBackend = MakeInferenceBackend(
+				config.shadowBackend, *_shadowModels, obsSize, actionParser->GetActionAmount(), useGPU, config.shadowPrecision
+			);
+			ConfigureBackend(*shadowBackend);
+			if (config.hugePageWeights)
+				shadowBackend->MoveWeightsToHugePages();
+			if (config.leanMemory && !shadowBackend->NeedsModels())
+				_shadowModels.reset();
+
+			StartShadow(std::move(shadowBackend));
+		}
+		catch (std::exception& e) {
+			// The shadow is only an experiment, so the bot still runs without it
+			RG_LOG("InferUnit: Failed to set up the shadow backend from " << shadowFolder << ", running without it\nException: " << e.what());
+			_shadowModels.reset();
+		}
+	}
+
+	if (config.watchModels) {
+		_watchThread = std::thread(&InferUnit::WatchModels, this);
+		RG_LOG("InferUnit: Watching " << _modelsFolder << " for new models");
+	}
 }
 
-RLGC::Action GGL::InferUnit::InferAction(
-	const RLGC::Player& player,
-	const RLGC::GameState& state,
-	bool deterministic,
-	float temperature
-) {
-	return BatchInferActions({ player }, { state }, deterministic, temperature)[0];
+void GGL::InferUnit::ConfigureBackend(InferenceBackend& backend) {
+	auto nativeBackend = dynamic_cast<NativeInferenceBackend*>(&backend);
+	if (nativeBackend)
+		nativeBackend->sparseOutput = config.sparseOutput;
+
+	if (nativeBackend && nativeBackend->quantPlan) {
+		if (!config.int8CalibrationPath.empty()) {
+			auto recording = ObsRecording::Load(config.int8CalibrationPath);
+			if (recording.obsSize != obsSize || recording.numActions != actionParser->GetActionAmount())
+				RG_ERR_CLOSE("InferUnit: INT8 calibration recording " << config.int8CalibrationPath << " doesn't match this obs size/action amount");
+			if (recording.numRecords == 0)
+				RG_ERR_CLOSE("InferUnit: INT8 calibration recording " << config.int8CalibrationPath << " is empty");
+
+			auto report = nativeBackend->CalibrateInt8(recording.obs.data(), recording.actionMasks.data(), recording.numRecords, true);
+			RG_LOG(
+				"InferUnit: Calibrated INT8 on " << report.numSamples << " recorded obs: " <<
+				(report.argmaxAgreement * 100) << "% argmax agreement with fp32, max logit diff " << report.maxLogitDiff
+			);
+		} else {
+			RG_LOG("InferUnit: No INT8 calibration recording set, using dynamic activation scales");
+		}
+
+		// Only the INT8 weights are needed from here on
+		nativeBackend->FreeInt8Reference();
+	}
 }
 
-std::vector<RLGC::Action> GGL::InferUnit::BatchInferActions(
-	const std::vector<RLGC::Player>& players,
-	const std::vector<RLGC::GameState>& states,
-	bool deterministic,
-	float temperature
+std::string GGL::InferUnit::GetModelFilesSignature() {
+	std::stringstream signature;
+	for (auto& fileName : _watchedFileNames) {
+		auto path = Model::FindModelFile(_modelsFolder, fileName);
+
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(path, error);
+		auto size = error ? 0 : std::filesystem::file_size(path, error);
+		if (error) {
+			signature << fileName << ":missing;";
+		} else {
+			signature << fileName << ":" << writeTime.time_since_epoch().count() << ":" << size << ";";
+		}
+	}
+	return signature.str();
+}
+
+void GGL::InferUnit::WatchModels() {
+	RG_NO_GRAD;
+
+	int numActions = actionParser->GetActionAmount();
+	auto interval = std::chrono::duration<float>(RS_MAX(config.watchIntervalSeconds, 0.1f));
+
+	std::string loadedSignature = GetModelFilesSignature();
+	std::string candidateSignature;
+
+	while (true) {
+		std::unique_ptr<ModelSet> oldModels;
+		std::unique_ptr<InferenceBackend> oldBackend;
+		{
+			std::unique_lock<std::mutex> lock(_watchMutex);
+			_watchCV.wait_for(lock, interval, [&] { return _stopWatching; });
+			if (_stopWatching)
+				break;
+
+			// Free whatever the last swap replaced here rather than on the decision thread
+			oldBackend = std::move(_retiredBackend);
+			oldModels = std::move(_retiredModels);
+		}
+		oldBackend.reset(); // Backends can reference their models
+		oldModels.reset();
+
+		std::string signature = GetModelFilesSignature();
+		if (signature == loadedSignature) {
+			candidateSignature.clear();
+			continue;
+		}
+
+		// Wait for one more poll without changes, so a checkpoint that's still being written isn't loaded
+		if (signature != candidateSignature) {
+			candidateSignature = signature;
+			continue;
+		}
+		loadedSignature = signature;
+		candidateSignature.clear();
+
+		RG_LOG("InferUnit: Model files changed, reloading in the background");
+
+		auto newModels = std::make_unique<ModelSet>();
+		std::unique_ptr<InferenceBackend> newBackend;
+		try {
+			GGL::Infer::MakeInferenceModels(
+				obsSize, numActions, _sharedHeadConfig, _policyConfig,
+				useGPU ? torch::kCUDA : torch::kCPU, *newModels
+			);
+
+			// Throws if any parameter shape doesn't match the config
+			newModels->Load(_modelsFolder, false, false);
+			if (config.profileLayers && config.backend == InferBackendType::TORCH)
+				newModels->EnableProfiling();
+
+			newBackend = MakeInferenceBackend(config.backend, *newModels, obsSize, numActions, useGPU, config.precision);
+			ConfigureBackend(*newBackend);
+
+			if (config.hugePageWeights)
+				newBackend->MoveWeightsToHugePages();
+			if (config.leanMemory) {
+				if (!newBackend->NeedsModels())
+					newModels.reset();
+				ReleaseFreeMemory();
+			}
+
+			// Get the cold passes out of the way before the swap
+			std::vector<float> warmupObs(obsSize), warmupLogits(numActions);
+			newBackend->Prefault();
+			for (int i = 0; i < 3; i++)
+				newBackend->InferLogits(warmupObs.data(), 1, warmupLogits.data());
+
+			// Uses the server again once it runs the new models too
+			if (!config.inferServerName.empty())
+				newBackend = std::make_unique<RemoteInferenceBackend>(config.inferServerName, std::move(newBackend), config.inferServerTimeoutUs);
+		}
+		catch (std::exception& e) {
+			RG_LOG("InferUnit: Failed to reload models, keeping the current ones\nException: " << e.what());
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_watchMutex);
+
+			// Replaces a reload that no decision has picked up yet
+			oldBackend = std::move(_pendingBackend);
+			oldModels = std::move(_pendingModels);
+
+			_pendingModels = std::move(newModels);
+			_pendingBackend = std::move(newBackend);
+			_swapPending = true;
+		}
+		oldBackend.reset();
+		oldModels.reset();
+	}
+}
+
+void GGL::InferUnit::TrySwapModels() {
+	std::unique_lock<std::mutex> lock(_watchMutex, std::try_to_lock);
+	if (!lock.owns_lock())
+		return;
+
+	if (!_pendingBackend)
+		return;
+
+	// The watcher frees the old ones
+	_retiredBackend = std::move(backend);
+	_retiredModels = std::move(models);
+	backend = std::move(_pendingBackend);
+	models = std::move(_pendingModels);
+	_swapPending = false;
+	modelGeneration++;
+
+	lock.unlock();
+
+	RG_LOG("InferUnit: Swapped in new models (generation " << modelGeneration << ", " << backend->GetName() << " backend)");
+}
+#endif
+
+GGL::InferUnit::InferUnit(
+	RLGC::ObsBuilder* obsBuilder, int obsSize, RLGC::ActionParser* actionParser,
+	std::unique_ptr<InferenceBackend> backend, const InferUnitConfig& config) :
+	obsBuilder(obsBuilder), obsSize(obsSize), actionParser(actionParser), backend(std::move(backend)), config(config) {
+
+	RG_ASSERT(this->backend);
+	if (this->backend->obsSize != obsSize || this->backend->numActions != actionParser->GetActionAmount()) {
+		RG_ERR_CLOSE(
+			"InferUnit: Backend maps " << this->backend->obsSize << " -> " << this->backend->numActions <<
+			", expected " << obsSize << " -> " << actionParser->GetActionAmount()
+		);
+	}
+
+	InitCommon();
+}
+
+void GGL::InferUnit::InitCommon() {
+	if (!config.inferServerName.empty())
+		backend = std::make_unique<RemoteInferenceBackend>(config.inferServerName, std::move(backend), config.inferServerTimeoutUs);
+
+	RG_LOG(
+		"InferUnit: Using " << backend->GetName() << " backend, " << GetInferPrecisionName(backend->precision) << " precision" <<
+		" (requested " << GetInferPrecisionName(config.precision) << ", CPU bf16 support: " << (Native::HasFastBF16() ? "yes" : "no") << ")"
+	);
+
+	if (!config.recordObsPath.empty()) {
+		_obsRecorder = std::make_unique<ObsRecordWriter>(config.recordObsPath, obsSize, actionParser->GetActionAmount());
+		RG_LOG("InferUnit: Recording observations to " << config.recordObsPath);
+	}
+
+	PolicySlot mainPolicy = {};
+	mainPolicy.name = "main";
+	_policies.push_back(std::move(mainPolicy));
+	_ensembleRNG.Seed(std::random_device{}());
+
+	EnsureStagingCapacity(RS_MAX(config.maxBatchSize, 1));
+
+	if (config.hugePageWeights) {
+		size_t movedBytes = backend->MoveWeightsToHugePages();
+		if (movedBytes == 0) {
+			RG_LOG("InferUnit: Huge page weights are only supported by the native backends on Linux, with weight arenas of at least 256KB");
+		} else if (!AreHugePagesEnabled()) {
+			RG_LOG("InferUnit: Moved " << BytesToMB(movedBytes) << "MB of weights to huge-page-aligned memory, but transparent huge pages are disabled on this system");
+		} else {
+			RG_LOG("InferUnit: Moved " << BytesToMB(movedBytes) << "MB of weights to huge-page-aligned memory advised for transparent huge pages");
+		}
+	}
+
+	LogMemoryUsage("after loading");
+	if (config.memoryReportIntervalSeconds > 0)
+		_memoryReportThread = std::thread(&InferUnit::ReportMemory, this);
+
+	if (config.intraOpThreads > 0 && backend->UsesIntraOpThreads()) {
+		_intraOpThreadsByBatchSize.assign(RS_MAX(config.maxBatchSize, 1), config.intraOpThreads);
+		RG_LOG("InferUnit: Pinned libtorch to " << config.intraOpThreads << " intra-op threads");
+	}
+}
+
+void GGL::InferUnit::LogMemoryUsage(const char* when) {
+	auto usage = GetMemoryUsage();
+	if (usage.rssBytes == 0)
+		return; // Not reported on this platform
+
+	RG_LOG("InferUnit: Memory " << when << ": RSS " << BytesToMB(usage.rssBytes) << "MB, peak " << BytesToMB(usage.peakRssBytes) << "MB");
+}
+
+void GGL::InferUnit::ReportMemory() {
+	auto interval = std::chrono::duration<float>(RS_MAX(config.memoryReportIntervalSeconds, 1.f));
+
+	std::unique_lock<std::mutex> lock(_memoryReportMutex);
+	while (!_memoryReportCV.wait_for(lock, interval, [&] { return _stopMemoryReport; }))
+		LogMemoryUsage("now");
+}
+
+void GGL::InferUnit::TuneIntraOpThreads() {
+#ifndef GGL_NO_TORCH
+	if (config.intraOpThreads != 0 || !backend->UsesIntraOpThreads())
+		return;
+
+	constexpr int NUM_SETUP_PASSES = 2, NUM_TIMED_PASSES = 15;
+
+	// Fewer threads win ties, a count needs to be this much faster than the best so far to be picked
+	constexpr double MIN_IMPROVEMENT = 0.05;
+
+	int maxBatchSize = RS_MAX(config.maxBatchSize, 1);
+	int maxThreads = RS_MAX(RS_MIN(config.maxTuneThreads, (int)std::thread::hardware_concurrency()), 1);
+
+	std::vector<int> threadCounts;
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads = (numThreads < 4) ? (numThreads + 1) : (numThreads * 2))
+		threadCounts.push_back(numThreads);
+	if (threadCounts.back() != maxThreads)
+		threadCounts.push_back(maxThreads);
+
+	std::vector<float> obs((size_t)maxBatchSize * obsSize), logits((size_t)maxBatchSize * backend->numActions);
+	FastRNG rng(0);
+	for (float& val : obs)
+		val = rng.NextFloat() * 2 - 1;
+
+	std::lock_guard<std::mutex> lock(_inferMutex);
+
+	_intraOpThreadsByBatchSize.clear();
+	std::stringstream results;
+	std::vector<double> passMs(NUM_TIMED_PASSES);
+	for (int batchSize = 1; batchSize <= maxBatchSize; batchSize++) {
+		int bestThreads = 0;
+		double bestMs = 0;
+		for (int numThreads : threadCounts) {
+			at::set_num_threads(numThreads);
+
+			for (int i = 0; i < NUM_SETUP_PASSES; i++)
+				backend->InferLogits(obs.data(), batchSize, logits.data());
+
+			for (int i = 0; i < NUM_TIMED_PASSES; i++) {
+				auto startTime = std::chrono::steady_clock::now();
+				backend->InferLogits(obs.data(), batchSize, logits.data());
+				passMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+			}
+
+			// Median, so a single preemption doesn't decide it
+			std::nth_element(passMs.begin(), passMs.begin() + NUM_TIMED_PASSES / 2, passMs.end());
+			double medianMs = passMs[NUM_TIMED_PASSES / 2];
+			if (bestThreads == 0 || medianMs < bestMs * (1 - MIN_IMPROVEMENT)) {
+				bestThreads = numThreads;
+				bestMs = medianMs;
+			}
+		}
+
+		_intraOpThreadsByBatchSize.push_back(bestThreads);
+		results << (batchSize > 1 ? ", " : "") << batchSize << ": " << bestThreads << " (" << bestMs << "ms)";
+	}
+
+	at::set_num_threads(_intraOpThreadsByBatchSize[0]);
+	RG_LOG("InferUnit: Tuned libtorch intra-op threads by batch size (tried up to " << maxThreads << "): " << results.str());
+#endif
+}
+
+void GGL::InferUnit::ApplyIntraOpThreads(int batchSize) {
+#ifndef GGL_NO_TORCH
+	if (_intraOpThreadsByBatchSize.empty())
+		return;
+
+	int numThreads = _intraOpThreadsByBatchSize[RS_MIN(batchSize, (int)_intraOpThreadsByBatchSize.size()) - 1];
+
+	// Checked every call, since with OpenMP builds the count belongs to the calling thread
+	if (at::get_num_threads() != numThreads)
+		at::set_num_threads(numThreads);
+#endif
+}
+
+void GGL::InferUnit::StartShadow(std::unique_ptr<InferenceBackend> shadowBackend) {
+	RG_ASSERT(shadowBackend);
+	if (shadowBackend->obsSize != obsSize || shadowBackend->numActions != actionParser->GetActionAmount()) {
+		RG_ERR_CLOSE(
+			"InferUnit: Shadow backend maps " << shadowBackend->obsSize << " -> " << shadowBackend->numActions <<
+			", expected " << obsSize << " -> " << actionParser->GetActionAmount()
+		);
+	}
+
+	std::lock_guard<std::mutex> lock(_inferMutex);
+	_shadow = std::make_unique<ShadowEvaluator>(std::move(shadowBackend), RS_MAX(config.maxBatchSize, 1));
+	RG_LOG(
+		"InferUnit: Shadowing decisions on " << _shadow->GetBackendName() << " backend, " <<
+		GetInferPrecisionName(_shadow->GetBackendPrecision()) << " precision"
+	);
+}
+
+bool GGL::InferUnit::DumpShadowReport() {
+	std::lock_guard<std::mutex> lock(_inferMutex);
+	if (!_shadow)
+		return false;
+
+	auto report = _shadow->TakeReport();
+	if (report.numCalls == 0 && report.numDropped == 0)
+		return false;
+
+	auto getPathName = [](const char* name, InferPrecision precision) {
+		return std::string(name) + "-" + GetInferPrecisionName(precision);
+	};
+	std::string primaryName = getPathName(backend->GetName(), backend->precision);
+	std::string shadowName = getPathName(_shadow->GetBackendName(), _shadow->GetBackendPrecision());
+
+	LogShadowReport(report, primaryName.c_str(), shadowName.c_str());
+	if (!config.shadowReportPath.empty())
+		AppendShadowReportCSV(config.shadowReportPath, report, primaryName.c_str(), shadowName.c_str());
+	return true;
+}
+
+void GGL::InferUnit::EnsureStagingCapacity(int batchSize) {
+	if (batchSize <= _stagingCapacity)
+		return;
+
+	int numActions = actionParser->GetActionAmount();
+
+	_obsStaging.resize((size_t)batchSize * obsSize);
+	_maskStaging.resize((size_t)batchSize * numActions);
+	_actionStaging.resize(batchSize);
+
+	_rowPolicies.resize(batchSize);
+	_groupRows.resize(batchSize);
+	_groupObs.resize((size_t)batchSize * obsSize);
+	_groupMasks.resize((size_t)batchSize * numActions);
+	_groupActions.resize(batchSize);
+	_groupLogProbs.resize(batchSize);
+	_groupRNGs.resize(batchSize);
+	_ensembleLogits.resize((size_t)batchSize * numActions);
+	_ensembleMemberLogits.resize((size_t)batchSize * numActions);
+
+	_stagingCapacity = batchSize;
+}
+
+void GGL::InferUnit::SetPolicyRouter(PolicyRouter router) {
+	std::lock_guard<std::mutex> lock(_inferMutex);
+	_policyRouter = std::move(router);
+}
+
+#ifndef GGL_NO_TORCH
+int GGL::InferUnit::AddPolicy(
+	const std::string& name, const std::filesystem::path& modelsFolder,
+	InferPartialModelConfig sharedHeadConfig, InferPartialModelConfig policyConfig) {
+
+	RG_NO_GRAD;
+
+	int numActions = actionParser->GetActionAmount();
+
+	PolicySlot slot = {};
+	slot.name = name;
+	slot.models = std::make_unique<ModelSet>();
+	try {
+		GGL::Infer::MakeInferenceModels(
+			obsSize, numActions, sharedHeadConfig, policyConfig,
+			useGPU ? torch::kCUDA : torch::kCPU, *slot.models
+		);
+		slot.models->Load(modelsFolder, false, false);
+		slot.backend = MakeInferenceBackend(config.backend, *slot.models, obsSize, numActions, useGPU, config.precision);
+	}
+	catch (std::exception& e) {
+		RG_ERR_CLOSE("InferUnit: Exception when trying to load policy \"" << name << "\" from " << modelsFolder << ": " << e.what());
+	}
+
+	ConfigureBackend(*slot.backend);
+	if (config.hugePageWeights)
+		slot.backend->MoveWeightsToHugePages();
+	if (config.leanMemory) {
+		if (!slot.backend->NeedsModels())
+			slot.models.reset();
+		ReleaseFreeMemory();
+	}
+
+	return AddPolicySlot(std::move(slot));
+}
+#endif
+
+int GGL::InferUnit::AddPolicy(const std::string& name, std::unique_ptr<InferenceBackend> policyBackend) {
+	RG_ASSERT(policyBackend);
+	if (policyBackend->obsSize != obsSize || policyBackend->numActions != actionParser->GetActionAmount()) {
+		RG_ERR_CLOSE(
+			"InferUnit: Policy \"" << name << "\" maps " << policyBackend->obsSize << " -> " << policyBackend->numActions <<
+			", expected " << obsSize << " -> " << actionParser->GetActionAmount()
+		);
+	}
+
+	PolicySlot slot = {};
+	slot.name = name;
+	slot.backend = std::move(policyBackend);
+	return AddPolicySlot(std::move(slot));
+}
+
+int GGL::InferUnit::AddEnsemble(const std::string& name, const std::vector<int>& memberPolicies) {
+	PolicySlot slot = {};
+	slot.name = name;
+	slot.ensembleMembers = memberPolicies;
+	return AddPolicySlot(std::move(slot));
+}
+
+int GGL::InferUnit::AddPolicySlot(PolicySlot&& slot) {
+	std::lock_guard<std::mutex> lock(_inferMutex);
+
+	for (auto& other : _policies)
+		if (other.name == slot.name)
+			RG_ERR_CLOSE("InferUnit: There is already a policy named \"" << slot.name << "\"");
+
+	if (!slot.backend) {
+		if (slot.ensembleMembers.empty())
+			RG_ERR_CLOSE("InferUnit: Ensemble \"" << slot.name << "\" has no members");
+
+		for (int member : slot.ensembleMembers) {
+			if (member < 0 || member >= (int)_policies.size())
+				RG_ERR_CLOSE("InferUnit: Ensemble \"" << slot.name << "\" has an invalid member policy index " << member);
+			if (!_policies[member].ensembleMembers.empty())
+				RG_ERR_CLOSE("InferUnit: Ensemble \"" << slot.name << "\" can't contain another ensemble (\"" << _policies[member].name << "\")");
+		}
+	}
+
+	int index = (int)_policies.size();
+	_policies.push_back(std::move(slot));
+
+	auto& added = _policies.back();
+	if (added.backend) {
+		added.backend->Prefault();
+		RG_LOG("InferUnit: Added policy \"" << added.name << "\" (index " << index << ", " << added.backend->GetName() << " backend)");
+	} else {
+		RG_LOG("InferUnit: Added ensemble \"" << added.name << "\" (index " << index << ", " << added.ensembleMembers.size() << " members)");
+	}
+	return index;
+}
+
+int GGL::InferUnit::FindPolicy(const std::string& name) {
+	std::lock_guard<std::mutex> lock(_inferMutex);
+	for (int i = 0; i < (int)_policies.size(); i++)
+		if (_policies[i].name == name)
+			return i;
+	return -1;
+}
+
+int GGL::InferUnit::GetNumPolicies() {
+	std::lock_guard<std::mutex> lock(_inferMutex);
+	return (int)_policies.size();
+}
+
+GGL::InferenceBackend* GGL::InferUnit::GetPolicyBackend(int policyIndex) {
+	// Policy 0 isn't stored in its slot, since hot reloading swaps InferUnit::backend
+	return (policyIndex == 0) ? backend.get() : _policies[policyIndex].backend.get();
+}
+
+void GGL::InferUnit::RunPolicy(
+	int policyIndex, const float* obs, const uint8_t* actionMasks, int numRows, bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	auto& slot = _policies[policyIndex];
+	int numActions = actionParser->GetActionAmount();
+
+	if (!slot.ensembleMembers.empty()) {
+		size_t numLogits = (size_t)numRows * numActions;
+		std::fill(_ensembleLogits.begin(), _ensembleLogits.begin() + numLogits, 0.f);
+		for (int member : slot.ensembleMembers) {
+			GetPolicyBackend(member)->InferLogits(obs, numRows, _ensembleMemberLogits.data());
+			for (size_t i = 0; i < numLogits; i++)
+				_ensembleLogits[i] += _ensembleMemberLogits[i];
+		}
+
+		float scale = 1.f / slot.ensembleMembers.size();
+		for (size_t i = 0; i < numLogits; i++)
+			_ensembleLogits[i] *= scale;
+
+		SelectMaskedActions(
+			_ensembleLogits.data(), numActions, actionMasks, numRows, numActions,
+			deterministic, temperature, outActions, outLogProbs, rngs, _ensembleRNG
+		);
+		return;
+	}
+
+	auto inferStartTime = std::chrono::steady_clock::now();
+	GetPolicyBackend(policyIndex)->InferActions(obs, actionMasks, numRows, deterministic, temperature, outActions, outLogProbs, rngs);
+
+	if (policyIndex == 0 && _shadow) {
+		double inferUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - inferStartTime).count();
+		_shadow->Submit(obs, actionMasks, numRows, deterministic, temperature, outActions, inferUs);
+	}
+}
+
+bool GGL::InferUnit::MakeSyntheticState(RLGC::GameState& outState) {
+	std::vector<float> obs(obsSize);
+
+	// The obs size usually depends on the player count, so try 1v1, 2v2 and 3v3
+	for (int numPlayers = 2; numPlayers <= 6; numPlayers += 2) {
+		RLGC::GameState state = {};
+		for (int i = 0; i < numPlayers; i++) {
+			RLGC::Player player = {};
+			player.index = i;
+			player.carId = i + 1;
+			player.team = (i < numPlayers / 2) ? Team::BLUE : Team::ORANGE;
+			player.pos = Vec(0, (player.team == Team::BLUE) ? -2048 : 2048, 17);
+			player.isOnGround = true;
+			player.boost = 33.3f;
+			state.players.push_back(player);
+		}
+
+		if (obsBuilder->BuildObsInto(state.players[0], state, obs.data(), obsSize) == obsSize) {
+			outState = std::move(state);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+GGL::InferWarmupReport GGL::InferUnit::Warmup(int passesPerBatchSize) {
+	using Clock = std::chrono::steady_clock;
+	auto getElapsedMs = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	auto startTime = Clock::now();
+	passesPerBatchSize = RS_MAX(passesPerBatchSize, 1);
+	int maxBatchSize = RS_MAX(config.maxBatchSize, 1);
+	int numActions = actionParser->GetActionAmount();
+
+	InferWarmupReport report = {};
+	report.loadMs = loadTimeMs;
+
+	// Synthetic obs shouldn't end up in the recording, the shadow stats or the layer profiles
+	auto obsRecorder = std::move(_obsRecorder);
+	auto shadow = std::move(_shadow);
+
+	backend->Prefault();
+	report.prefaultMs = getElapsedMs(startTime);
+
+	auto tuneStartTime = Clock::now();
+	TuneIntraOpThreads();
+	report.threadTuneMs = getElapsedMs(tuneStartTime);
+	report.intraOpThreads = _intraOpThreadsByBatchSize;
+
+	RLGC::GameState state;
+	report.primedObs = MakeSyntheticState(state);
+	if (!report.primedObs)
+		RG_LOG("InferUnit: Warmup couldn't build a synthetic state matching obs size " << obsSize << ", only warming the backend");
+
+	std::vector<FastRNG> rngs(maxBatchSize);
+	std::vector<RLGC::Action> actions(maxBatchSize);
+	for (int batchSize = 1; batchSize <= maxBatchSize; batchSize++) {
+		std::vector<int> playerIndices;
+		if (report.primedObs)
+			for (int i = 0; i < batchSize; i++)
+				playerIndices.push_back(i % (int)state.players.size());
+
+		double passMs = 0;
+		for (int pass = 0; pass < passesPerBatchSize; pass++) {
+			// Both selection paths get warmed, ending on deterministic
+			bool deterministic = ((passesPerBatchSize - 1 - pass) % 2 == 0);
+
+			auto passStartTime = Clock::now();
+			if (report.primedObs) {
+				BatchInferActions(state, playerIndices, deterministic, 1, rngs.data(), actions.data());
+			} else {
+				std::lock_guard<std::mutex> lock(_inferMutex);
+				EnsureStagingCapacity(batchSize);
+				ApplyIntraOpThreads(batchSize);
+				std::fill(_obsStaging.begin(), _obsStaging.begin() + (size_t)batchSize * obsSize, 0.f);
+				std::fill(_maskStaging.begin(), _maskStaging.begin() + (size_t)batchSize * numActions, 1);
+				backend->InferActions(
+					_obsStaging.data(), _maskStaging.data(), batchSize, deterministic, 1, _actionStaging.data(), NULL, rngs.data()
+				);
+			}
+			passMs = getElapsedMs(passStartTime);
+
+			if (batchSize == 1 && pass == 0)
+				report.firstInferenceMs = passMs;
+		}
+
+		report.warmBatchMs.push_back(passMs);
+	}
+
+	// The router decides what the passes above used, so the other policies get their backends warmed directly
+	{
+		std::lock_guard<std::mutex> lock(_inferMutex);
+		EnsureStagingCapacity(maxBatchSize);
+		for (int policy = 1; policy < (int)_policies.size(); policy++) {
+			auto policyBackend = _policies[policy].backend.get();
+			if (!policyBackend)
+				continue; // Ensembles only run their members
+
+			for (int batchSize = 1; batchSize <= maxBatchSize; batchSize++)
+				for (int pass = 0; pass < passesPerBatchSize; pass++)
+					policyBackend->InferLogits(_obsStaging.data(), batchSize, _ensembleMemberLogits.data());
+		}
+	}
+
+	_obsRecorder = std::move(obsRecorder);
+	_shadow = std::move(shadow);
+#ifndef GGL_NO_TORCH
+	if (models)
+		models->ResetProfiles();
+#endif
+	report.warmupMs = getElapsedMs(startTime);
+
+	RG_LOG(
+		"InferUnit: Startup timing: load " << report.loadMs << "ms, prefault " << report.prefaultMs <<
+		"ms, thread tuning " << report.threadTuneMs << "ms, first inference " << report.firstInferenceMs << "ms, warmup total " << report.warmupMs << "ms"
+	);
+
+	std::stringstream batchTimes;
+	for (int i = 0; i < (int)report.warmBatchMs.size(); i++)
+		batchTimes << (i > 0 ? ", " : "") << (i + 1) << ": " << report.warmBatchMs[i] << "ms";
+	RG_LOG("InferUnit: Warm decision time by batch size: " << batchTimes.str());
+	LogMemoryUsage("after warmup");
+
+	return report;
+}
+
+template <typename GetPlayer, typename GetState>
+void GGL::InferUnit::BatchInferImpl(
+	int batchSize, GetPlayer getPlayer, GetState getState, bool deterministic, float temperature,
+	FastRNG* rngs, RLGC::Action* outActions, float* outLogProbs
 ) {
-	RG_ASSERT(players.size() > 0 && states.size() > 0);
-	RG_ASSERT(players.size() == states.size());
+	RG_ASSERT(batchSize > 0);
+
+	int numActions = actionParser->GetActionAmount();
+
+	std::lock_guard<std::mutex> lock(_inferMutex);
 
-	int batchSize = (int)players.size();
-	std::vector<float> allObs;
-	std::vector<uint8_t> allActionMasks;
+#ifndef GGL_NO_TORCH
+	if (_swapPending)
+		TrySwapModels();
+#endif
+
+	EnsureStagingCapacity(batchSize);
 
 	for (int i = 0; i < batchSize; i++) {
-		FList curObs = obsBuilder->BuildObs(players[i], states[i]);
-		if ((int)curObs.size() != obsSize) {
+		const RLGC::Player& player = getPlayer(i);
+		const RLGC::GameState& state = getState(i);
+
+		float* curObs = _obsStaging.data() + (size_t)i * obsSize;
+		int curObsSize = obsBuilder->BuildObsInto(player, state, curObs, obsSize);
+		if (curObsSize != obsSize) {
 			RG_ERR_CLOSE(
-				"InferUnit: Obs builder produced an obs that differs from the provided size (expected: " << obsSize << ", got: " << curObs.size() << ")\n"
+				"InferUnit: Obs builder produced an obs that differs from the provided size (expected: " << obsSize << ", got: " << curObsSize << ")\n"
 				"Make sure you provided the correct obs size to the InferUnit constructor.\n"
-				"Also, make sure there aren't an incorrect number of players (there are " << states[i].players.size() << " in this state)"
+				"Also, make sure there aren't an incorrect number of players (there are " << state.players.size() << " in this state)"
 			);
 		}
-		allObs += curObs;
-		allActionMasks += actionParser->GetActionMask(players[i], states[i]);
+
+		actionParser->GetActionMaskInto(player, state, _maskStaging.data() + (size_t)i * numActions);
 	}
 
-	std::vector<RLGC::Action> results;
+	if (_obsRecorder)
+		_obsRecorder->Write(_obsStaging.data(), _maskStaging.data(), batchSize);
 
-	try {
-		RG_NO_GRAD;
+	// Deterministic actions have no log-prob, report 0 (probability 1)
+	if (outLogProbs)
+		std::fill(outLogProbs, outLogProbs + batchSize, 0.f);
+
+	bool singlePolicy = true;
+	for (int i = 0; i < batchSize; i++) {
+		int policy = 0;
+		if (_policyRouter && _policies.size() > 1) {
+			policy = _policyRouter(getPlayer(i), getState(i));
+			if (policy < 0 || policy >= (int)_policies.size())
+				RG_ERR_CLOSE("InferUnit: Policy router returned " << policy << ", but there are only " << _policies.size() << " policies");
+		}
 
-		auto device = useGPU ? torch::kCUDA : torch::kCPU;
+		_rowPolicies[i] = policy;
+		singlePolicy &= (policy == _rowPolicies[0]);
+	}
 
-		auto tObs = torch::tensor(allObs).reshape({ (int64_t)batchSize, (int64_t)obsSize }).to(device);
-		auto tMasks = torch::tensor(allActionMasks).reshape({ (int64_t)batchSize, (int64_t)actionParser->GetActionAmount() }).to(device);
+	ApplyIntraOpThreads(batchSize);
 
-		torch::Tensor tActions, tLogProbs;
+	try {
+		if (singlePolicy) {
+			RunPolicy(
+				_rowPolicies[0], _obsStaging.data(), _maskStaging.data(), batchSize, deterministic, temperature,
+				_actionStaging.data(), outLogProbs, rngs
+			);
+		} else {
+			// Gather each policy's rows into one contiguous batch, then scatter the results back
+			for (int policy = 0; policy < (int)_policies.size(); policy++) {
+				int numRows = 0;
+				for (int i = 0; i < batchSize; i++) {
+					if (_rowPolicies[i] != policy)
+						continue;
 
-		GGL::Infer::InferActions(
-			*models,
-			tObs,
-			tMasks,
-			deterministic,
-			temperature,
-			/*halfPrec*/ false,
-			&tActions,
-			&tLogProbs
-		);
+					memcpy(_groupObs.data() + (size_t)numRows * obsSize, _obsStaging.data() + (size_t)i * obsSize, obsSize * sizeof(float));
+					memcpy(_groupMasks.data() + (size_t)numRows * numActions, _maskStaging.data() + (size_t)i * numActions, numActions);
+					if (rngs)
+						_groupRNGs[numRows] = rngs[i];
+					_groupRows[numRows++] = i;
+				}
 
-		auto actionIndices = TENSOR_TO_VEC<int>(tActions);
+				if (numRows == 0)
+					continue;
 
-		for (int i = 0; i < batchSize; i++)
-			results.push_back(actionParser->ParseAction(actionIndices[i], players[i], states[i]));
+				std::fill(_groupLogProbs.begin(), _groupLogProbs.begin() + numRows, 0.f);
+				RunPolicy(
+					policy, _groupObs.data(), _groupMasks.data(), numRows, deterministic, temperature,
+					_groupActions.data(), outLogProbs ? _groupLogProbs.data() : NULL, rngs ? _groupRNGs.data() : NULL
+				);
+
+				for (int j = 0; j < numRows; j++) {
+					int row = _groupRows[j];
+					_actionStaging[row] = _groupActions[j];
+					if (outLogProbs)
+						outLogProbs[row] = _groupLogProbs[j];
+					if (rngs)
+						rngs[row] = _groupRNGs[j]; // Carry the advanced generator state back
+				}
+			}
+		}
 
+		for (int i = 0; i < batchSize; i++)
+			outActions[i] = actionParser->ParseAction(_actionStaging[i], getPlayer(i), getState(i));
 	}
 	catch (std::exception& e) {
 		RG_ERR_CLOSE("InferUnit: Exception when inferring model: " << e.what());
 	}
+}
+
+RLGC::Action GGL::InferUnit::InferAction(
+	const RLGC::Player& player,
+	const RLGC::GameState& state,
+	bool deterministic,
+	float temperature,
+	FastRNG* rng,
+	float* outLogProb
+) {
+	RLGC::Action action;
+	BatchInferImpl(
+		1, [&](int) -> const RLGC::Player& { return player; }, [&](int) -> const RLGC::GameState& { return state; },
+		deterministic, temperature, rng, &action, outLogProb
+	);
+	return action;
+}
+
+std::vector<RLGC::Action> GGL::InferUnit::BatchInferActions(
+	const std::vector<RLGC::Player>& players,
+	const std::vector<RLGC::GameState>& states,
+	bool deterministic,
+	float temperature,
+	FastRNG* rngs,
+	std::vector<float>* outLogProbs
+) {
+	RG_ASSERT(players.size() == states.size());
+
+	std::vector<RLGC::Action> results(players.size());
+	if (outLogProbs)
+		outLogProbs->resize(players.size());
 
+	BatchInferImpl(
+		(int)players.size(), [&](int i) -> const RLGC::Player& { return players[i]; }, [&](int i) -> const RLGC::GameState& { return states[i]; },
+		deterministic, temperature, rngs, results.data(), outLogProbs ? outLogProbs->data() : NULL
+	);
 	return results;
 }
 
+void GGL::InferUnit::BatchInferActions(
+	std::span<const RLGC::Player* const> players,
+	std::span<const RLGC::GameState* const> states,
+	bool deterministic,
+	float temperature,
+	FastRNG* rngs,
+	RLGC::Action* outActions,
+	float* outLogProbs
+) {
+	RG_ASSERT(players.size() == states.size());
+
+	BatchInferImpl(
+		(int)players.size(), [&](int i) -> const RLGC::Player& { return *players[i]; }, [&](int i) -> const RLGC::GameState& { return *states[i]; },
+		deterministic, temperature, rngs, outActions, outLogProbs
+	);
+}
+
+void GGL::InferUnit::BatchInferActions(
+	const RLGC::GameState& state,
+	std::span<const int> playerIndices,
+	bool deterministic,
+	float temperature,
+	FastRNG* rngs,
+	RLGC::Action* outActions,
+	float* outLogProbs
+) {
+	for (int index : playerIndices)
+		RG_ASSERT(index >= 0 && index < (int)state.players.size());
+
+	BatchInferImpl(
+		(int)playerIndices.size(), [&](int i) -> const RLGC::Player& { return state.players[playerIndices[i]]; }, [&](int) -> const RLGC::GameState& { return state; },
+		deterministic, temperature, rngs, outActions, outLogProbs
+	);
+}
 
-GGL::InferUnit::~InferUnit() = default;
+GGL::InferUnit::~InferUnit() {
+	// Whatever the last match didn't dump
+	DumpShadowReport();
+	_shadow.reset();
+	_policies.clear();
+
+	if (_memoryReportThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_memoryReportMutex);
+			_stopMemoryReport = true;
+		}
+		_memoryReportCV.notify_one();
+		_memoryReportThread.join();
+	}
+
+#ifndef GGL_NO_TORCH
+	if (_watchThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_watchMutex);
+			_stopWatching = true;
+		}
+		_watchCV.notify_one();
+		_watchThread.join();
+	}
+
+	// Backends can reference their models, so they go first
+	_pendingBackend.reset();
+	_retiredBackend.reset();
+	backend.reset();
+#endif
+}
@@ -6,8 +6,16 @@
 #include <RLGymCPP/ActionParsers/ActionParser.h>
 
 #include "InferenceModelConfig.h"
+#include "InferenceBackend.h"
+#include "NativeKernels.h"
 #include <memory>
+#include <functional>
+#include <span>
 #include <filesystem>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 
 namespace RLGC {
 	class ObsBuilder;
@@ -20,23 +28,291 @@ namespace RLGC {
 namespace GGL {
 
 	struct ModelSet;
+	class ObsRecordWriter;
+	class ShadowEvaluator;
+
+	struct InferUnitConfig {
+		// Engine used on the hot path, GPU inference always uses libtorch
+		InferBackendType backend = InferBackendType::NATIVE;
+
+		// AUTO picks bf16 on CPUs with AVX512-BF16/AMX, see InferPrecision
+		InferPrecision precision = InferPrecision::AUTO;
+
+		// Native fp32/bf16 backends only compute the output-layer logits of actions enabled by the mask (INT8 computes them all)
+		bool sparseOutput = true;
+
+		// Compare the chosen backend's logits against libtorch (fp32) once at startup
+		bool checkParity = false;
+
+		// Time every layer of the models, logged when they're freed or on models->LogProfiles() (see Model::EnableProfiling())
+		// Only the TORCH backend runs the models layer by layer, so the other backends are left unprofiled
+		bool profileLayers = false;
+
+		// Staging buffers are preallocated for this many players (they grow if a bigger batch comes in)
+		// Warmup() covers every batch size up to this
+		int maxBatchSize = 8;
+
+		// If set, every inferred obs + action mask is appended to this file (see ObsRecording.h)
+		std::filesystem::path recordObsPath = {};
+
+		// Recorded observations used to calibrate NATIVE_INT8 activation scales and report agreement with fp32
+		// Without this, INT8 uses dynamic per-row activation scales
+		std::filesystem::path int8CalibrationPath = {};
+
+		// Watch the models folder and hot-swap in new checkpoints between decisions
+		// Loading, validation and backend setup all happen on a background thread, bad checkpoints are skipped
+		bool watchModels = false;
+		float watchIntervalSeconds = 2;
+
+		// Shadow mode: a second backend replays every decision on a background thread, its actions are never used
+		// Action agreement and latency distributions of both paths are logged at match end (see ShadowEvaluator)
+		bool shadowEnabled = false;
+		InferBackendType shadowBackend = InferBackendType::NATIVE;
+		InferPrecision shadowPrecision = InferPrecision::FP32;
+		std::filesystem::path shadowModelsFolder = {}; // Candidate models to compare, empty uses the live models folder
+		std::filesystem::path shadowReportPath = {};   // If set, each report is also appended here as a CSV row
+
+		// libtorch intra-op threads used by the libtorch backends (the native ones are single-threaded)
+		// 0 autotunes per batch size during Warmup(), -1 keeps libtorch's default, anything else pins that count
+		// Small batches are usually fastest on 1-2 threads, and fewer threads contend less with other bots on the host
+		int intraOpThreads = 0;
+		int maxTuneThreads = 8; // Largest count the autotuner tries (also capped to the hardware threads)
+
+		// Lean memory mode: once a backend with its own copy of the weights is built (anything but TORCH), the torch models are freed
+		// Memory freed after loading is also handed back to the OS. InferUnit::models is NULL when the models were freed
+		bool leanMemory = false;
+
+		// Move the backend's weights to huge-page-aligned memory advised for transparent huge pages
+		// Native backends on Linux only (see NativeInferenceBackend::MoveWeightsToHugePages()), each moved arena is rounded up to 2MB
+		bool hugePageWeights = false;
+
+		// Log RSS and peak RSS every this many seconds, 0 only logs at startup
+		float memoryReportIntervalSeconds = 0;
+
+		// Send decisions to the inference server running under this name (GGLBot --infer-server <name>, see InferServer)
+		// The server batches the decisions of every bot process on the machine that uses it, it must run the same models
+		// Decisions run in-process whenever the server is absent, full, running other models or slower than inferServerTimeoutUs
+		// Only policy 0 goes through the server
+		std::string inferServerName = {};
+		int inferServerTimeoutUs = 5000;
+
+		// libtorch inter-op threads, set once at construction, 0 keeps libtorch's default
+		// Single forward passes never use the inter-op pool, so this only avoids spawning idle threads
+		int interOpThreads = 1;
+	};
+
+	// Startup timings in milliseconds, see InferUnit::Warmup()
+	struct InferWarmupReport {
+		double loadMs = 0;           // Model loading and backend construction
+		double prefaultMs = 0;
+		double threadTuneMs = 0;
+		double firstInferenceMs = 0; // The first decision at batch size 1, cold unless thread tuning already ran the backend
+		double warmupMs = 0;         // All of Warmup(), including the first inference
+		std::vector<double> warmBatchMs; // Decision time per batch size once warm, index 0 is batch size 1
+		std::vector<int> intraOpThreads; // Pinned intra-op thread count per batch size, empty if not managed
+
+		// False if no synthetic state matched the obs size, then only the backend was warmed
+		bool primedObs = false;
+	};
 
 	struct RG_IMEXPORT InferUnit {
 		int obsSize = 0;
 		RLGC::ObsBuilder* obsBuilder = nullptr;      // not owned
 		RLGC::ActionParser* actionParser = nullptr;  // not owned
+#ifndef GGL_NO_TORCH
 		std::unique_ptr<ModelSet> models;
+#endif
+		std::unique_ptr<InferenceBackend> backend;
 		bool useGPU = false;
+		InferUnitConfig config;
+		double loadTimeMs = 0;
+
+		// Number of times new models were swapped in
+		std::atomic<int> modelGeneration = 0;
 
+#ifndef GGL_NO_TORCH
 		// NOTE: Reset() will never be called on your obs builder here.
 		InferUnit(
 			RLGC::ObsBuilder* obsBuilder, int obsSize, RLGC::ActionParser* actionParser,
 			InferPartialModelConfig sharedHeadConfig, InferPartialModelConfig policyConfig,
-			std::filesystem::path modelsFolder, bool useGPU);
+			std::filesystem::path modelsFolder, bool useGPU, const InferUnitConfig& config = {});
+#endif
+
+		// Runs an already built backend instead of loading models (e.g. CompiledInferenceBackend)
+		// config.backend and config.precision are ignored
+		InferUnit(
+			RLGC::ObsBuilder* obsBuilder, int obsSize, RLGC::ActionParser* actionParser,
+			std::unique_ptr<InferenceBackend> backend, const InferUnitConfig& config = {});
+
+		~InferUnit(); // frees models (if leanMemory didn't already)
+
+		// When sampling (!deterministic), rng gives the caller its own reproducible stream (one per player for batches)
+		// Without one, the backend's shared generator is used
+		RLGC::Action InferAction(
+			const RLGC::Player& player, const RLGC::GameState& state, bool deterministic, float temperature = 1,
+			FastRNG* rng = NULL, float* outLogProb = NULL
+		);
+		std::vector<RLGC::Action> BatchInferActions(
+			const std::vector<RLGC::Player>& players, const std::vector<RLGC::GameState>& states, bool deterministic, float temperature = 1,
+			FastRNG* rngs = NULL, std::vector<float>* outLogProbs = NULL
+		);
+
+		// Copy-free versions, nothing is allocated per call once the staging buffers have grown to the batch size
+		// players[i] decides in states[i], outActions (and outLogProbs if set) hold players.size() entries
+		void BatchInferActions(
+			std::span<const RLGC::Player* const> players, std::span<const RLGC::GameState* const> states, bool deterministic, float temperature,
+			FastRNG* rngs, RLGC::Action* outActions, float* outLogProbs = NULL
+		);
+
+		// Several players of one shared state (e.g. a hivemind), playerIndices index into state.players
+		void BatchInferActions(
+			const RLGC::GameState& state, std::span<const int> playerIndices, bool deterministic, float temperature,
+			FastRNG* rngs, RLGC::Action* outActions, float* outLogProbs = NULL
+		);
+
+		// Runs full decisions (obs building, masks, inference, action parsing) on synthetic states at every batch size up to config.maxBatchSize
+		// This moves lazy libtorch init, thread pool spin-up, page faults and buffer growth to before connecting
+		// Nothing is recorded to config.recordObsPath, and the timing breakdown is logged
+		InferWarmupReport Warmup(int passesPerBatchSize = 3);
+
+		// Decides which policy each player uses (see AddPolicy()), called once per player per decision
+		// Players routed to the same policy are inferred together in one batched call
+		// It runs with the InferUnit locked, so it must not call back into it
+		typedef std::function<int(const RLGC::Player& player, const RLGC::GameState& state)> PolicyRouter;
+
+		// Without a router, every player uses policy 0, the one given to the constructor (named "main")
+		void SetPolicyRouter(PolicyRouter router);
+
+#ifndef GGL_NO_TORCH
+		// Loads another shared_head + policy from modelsFolder, built with config.backend and config.precision, returns its index
+		// It shares the obs builder and action parser, so it must have the same obs size and action amount
+		// Only policy 0 is hot-reloaded, shadowed and thread-tuned
+		int AddPolicy(
+			const std::string& name, const std::filesystem::path& modelsFolder,
+			InferPartialModelConfig sharedHeadConfig, InferPartialModelConfig policyConfig
+		);
+#endif
+		int AddPolicy(const std::string& name, std::unique_ptr<InferenceBackend> policyBackend);
+
+		// A policy whose logits are the mean of its members' logits, members can't be ensembles themselves
+		int AddEnsemble(const std::string& name, const std::vector<int>& memberPolicies);
+
+		// -1 if there is no policy with that name
+		int FindPolicy(const std::string& name);
+		int GetNumPolicies();
+
+		// Replays every decision on shadowBackend from now on, replacing any previous shadow
+		void StartShadow(std::unique_ptr<InferenceBackend> shadowBackend);
+
+		// Logs (and appends to config.shadowReportPath) the shadow stats since the last dump, call at match end
+		// Returns false if there is no shadow or nothing was recorded
+		bool DumpShadowReport();
+
+	private:
+		// Persistent staging buffers that the obs builder and action parser write straight into
+		Native::AlignedVec<float> _obsStaging;
+		Native::AlignedVec<uint8_t> _maskStaging;
+		std::vector<int> _actionStaging;
+		int _stagingCapacity = 0;
+
+		std::unique_ptr<ObsRecordWriter> _obsRecorder;
+		std::unique_ptr<ShadowEvaluator> _shadow;
+#ifndef GGL_NO_TORCH
+		std::unique_ptr<ModelSet> _shadowModels; // Separate from models, so hot reloading never pulls them out from under the shadow
+#endif
+
+		// Bots may call in from their own threads, and the staging buffers are shared
+		std::mutex _inferMutex;
+
+		// Setup shared by both constructors, once the backend exists
+		void InitCommon();
+
+		std::thread _memoryReportThread;
+		std::mutex _memoryReportMutex;
+		std::condition_variable _memoryReportCV;
+		bool _stopMemoryReport = false;
+
+		void LogMemoryUsage(const char* when);
+		void ReportMemory();
+
+#ifndef GGL_NO_TORCH
+		// Hot reloading (see InferUnitConfig::watchModels)
+		InferPartialModelConfig _sharedHeadConfig, _policyConfig;
+		std::filesystem::path _modelsFolder;
+		std::vector<std::string> _watchedFileNames; // Fixed at construction, the watcher never touches the live models
+		std::thread _watchThread;
+
+		// Guards everything below, only ever held briefly (the decision thread only try-locks it)
+		std::mutex _watchMutex;
+		std::condition_variable _watchCV;
+		bool _stopWatching = false;
+		std::unique_ptr<ModelSet> _pendingModels, _retiredModels;
+		std::unique_ptr<InferenceBackend> _pendingBackend, _retiredBackend;
+		std::atomic<bool> _swapPending = false;
+
+		// Applies the InferUnitConfig options that depend on the backend type (sparse output, INT8 calibration)
+		void ConfigureBackend(InferenceBackend& backend);
+
+		void WatchModels();
+
+		// Identifies the current state of the model files, changes when any of them is written
+		std::string GetModelFilesSignature();
+
+		// Called between decisions with _inferMutex held
+		// Swaps in models loaded by the watcher, skipped (until the next decision) if the watcher is holding the slots
+		void TrySwapModels();
+#endif
+
+		struct PolicySlot {
+			std::string name;
+#ifndef GGL_NO_TORCH
+			std::unique_ptr<ModelSet> models; // Declared first so the backend is freed before it
+#endif
+			std::unique_ptr<InferenceBackend> backend; // NULL for policy 0 (which is InferUnit::backend) and ensembles
+			std::vector<int> ensembleMembers; // Only set for ensembles
+		};
+
+		// Guarded by _inferMutex
+		std::vector<PolicySlot> _policies;
+		PolicyRouter _policyRouter;
+
+		// Per-decision routing buffers, grown with the staging buffers so routing never allocates
+		std::vector<int> _rowPolicies, _groupRows;
+		Native::AlignedVec<float> _groupObs, _ensembleLogits, _ensembleMemberLogits;
+		Native::AlignedVec<uint8_t> _groupMasks;
+		std::vector<int> _groupActions;
+		std::vector<float> _groupLogProbs;
+		std::vector<FastRNG> _groupRNGs;
+		FastRNG _ensembleRNG;
+
+		int AddPolicySlot(PolicySlot&& slot);
+		InferenceBackend* GetPolicyBackend(int policyIndex);
+
+		// Infers rows of the staging buffers with one policy, rows are contiguous
+		void RunPolicy(
+			int policyIndex, const float* obs, const uint8_t* actionMasks, int numRows, bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		);
+
+		void EnsureStagingCapacity(int batchSize);
+
+		// Shared by all the BatchInferActions() overloads, getPlayer(i) and getState(i) return references to row i's player and state
+		template <typename GetPlayer, typename GetState>
+		void BatchInferImpl(
+			int batchSize, GetPlayer getPlayer, GetState getState, bool deterministic, float temperature,
+			FastRNG* rngs, RLGC::Action* outActions, float* outLogProbs
+		);
+
+		// Intra-op thread count per batch size (index 0 is batch size 1), empty if libtorch's threads aren't managed
+		std::vector<int> _intraOpThreadsByBatchSize;
+
+		// Times the backend over a grid of thread counts for each batch size up to config.maxBatchSize, fills _intraOpThreadsByBatchSize
+		void TuneIntraOpThreads();
 
-		~InferUnit(); // frees models
+		// Switches the calling thread's intra-op thread count to the one picked for batchSize
+		void ApplyIntraOpThreads(int batchSize);
 
-		RLGC::Action InferAction(const RLGC::Player& player, const RLGC::GameState& state, bool deterministic, float temperature = 1);
-		std::vector<RLGC::Action> BatchInferActions(const std::vector<RLGC::Player>& players, const std::vector<RLGC::GameState>& states, bool deterministic, float temperature = 1);
+		// Builds a kickoff-like state whose player count gives an obs of obsSize, returns false if none does
+		bool MakeSyntheticState(RLGC::GameState& outState);
 	};
 }
@@ -0,0 +1,163 @@
+#include "InferenceBackend.h"
+
+#include "NativeKernels.h"
+#include "MemoryUsage.h"
+
+#ifndef GGL_NO_TORCH
+#include "TorchBackend.h"
+#include "JitBackend.h"
+#include "OneDNNBackend.h"
+#include "NativeBackend.h"
+#endif
+
+#include <atomic>
+#include <random>
+
+GGL::InferPrecision GGL::ResolveInferPrecision(InferPrecision precision, bool useGPU) {
+	if (precision != InferPrecision::AUTO)
+		return precision;
+
+	// bf16 only pays off with hardware dot products, otherwise it's just extra conversions
+	return (!useGPU && Native::HasFastBF16()) ? InferPrecision::BF16 : InferPrecision::FP32;
+}
+
+#ifndef GGL_NO_TORCH
+std::unique_ptr<GGL::InferenceBackend> GGL::MakeInferenceBackend(
+	InferBackendType type, ModelSet& models, int obsSize, int numActions, bool useGPU,
+	InferPrecision precision) {
+
+	bool isTorchType = (type == InferBackendType::TORCH || type == InferBackendType::TORCH_JIT);
+	if (!isTorchType && useGPU) {
+		RG_LOG("MakeInferenceBackend(): The " << GetInferBackendTypeName(type) << " backend is CPU-only, using libtorch for GPU inference");
+		type = InferBackendType::TORCH;
+	}
+
+	precision = ResolveInferPrecision(precision, useGPU);
+	bool bf16 = (precision == InferPrecision::BF16);
+
+	if (bf16 && type == InferBackendType::NATIVE && !Native::GetCPUFeatures().avx512bf16) {
+		// The native bf16 kernels would fall back to a slow scalar emulation
+		RG_LOG("MakeInferenceBackend(): This CPU has no AVX512-BF16, the native backend will use fp32");
+		bf16 = false;
+	}
+
+	if (bf16 && (type == InferBackendType::TORCH_JIT || type == InferBackendType::TORCH_ONEDNN)) {
+		// optimize_for_inference() and the oneDNN path both target fp32 graphs
+		RG_LOG("MakeInferenceBackend(): The " << GetInferBackendTypeName(type) << " backend only runs fp32");
+		bf16 = false;
+	}
+
+	if (type == InferBackendType::TORCH_ONEDNN && !OneDNNInferenceBackend::IsAvailable()) {
+		RG_LOG("MakeInferenceBackend(): This libtorch build has no oneDNN, using libtorch");
+		type = InferBackendType::TORCH;
+	}
+
+	switch (type) {
+	case InferBackendType::TORCH:
+		return std::make_unique<TorchInferenceBackend>(models, obsSize, numActions, useGPU, bf16);
+	case InferBackendType::TORCH_JIT:
+		return std::make_unique<JitInferenceBackend>(models, obsSize, numActions, useGPU);
+	case InferBackendType::TORCH_ONEDNN:
+	{
+		auto backend = std::make_unique<OneDNNInferenceBackend>(models, obsSize, numActions);
+
+		// Self-test against the dense path, a broken oneDNN build shouldn't silently play with wrong logits
+		constexpr float ONEDNN_MAX_LOGIT_DIFF = 1e-3f;
+		TorchInferenceBackend dense(models, obsSize, numActions, false);
+		float maxDiff = CompareBackendLogits(*backend, dense);
+		if (maxDiff > ONEDNN_MAX_LOGIT_DIFF) {
+			RG_LOG("MakeInferenceBackend(): oneDNN logits differ from libtorch by " << maxDiff << ", using libtorch");
+			return std::make_unique<TorchInferenceBackend>(models, obsSize, numActions, useGPU);
+		}
+
+		RG_LOG("MakeInferenceBackend(): oneDNN self-test passed (max logit difference: " << maxDiff << ")");
+		return backend;
+	}
+	case InferBackendType::NATIVE:
+		return std::make_unique<NativeInferenceBackend>(models, obsSize, numActions, false, bf16);
+	case InferBackendType::NATIVE_INT8:
+		return std::make_unique<NativeInferenceBackend>(models, obsSize, numActions, true, false);
+	}
+
+	RG_ERR_CLOSE("MakeInferenceBackend(): Unknown backend type: " << (int)type);
+}
+#endif
+
+void GGL::InferenceBackend::Prefault() {
+	for (auto& region : GetWeightRegions())
+		PrefaultMemory(region.data, region.bytes);
+}
+
+void GGL::PrefaultMemory(const void* data, size_t bytes) {
+	constexpr size_t PAGE_SIZE = 4096;
+
+	const volatile uint8_t* bytePtr = (const volatile uint8_t*)data;
+	uint8_t sum = 0;
+	for (size_t i = 0; i < bytes; i += PAGE_SIZE)
+		sum += bytePtr[i];
+	if (bytes > 0)
+		sum += bytePtr[bytes - 1];
+	(void)sum;
+}
+
+void GGL::SelectMaskedActions(
+	const float* logits, int logitsStride, const uint8_t* actionMasks, int batchSize, int numActions,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs, FastRNG& fallbackRNG) {
+
+	for (int i = 0; i < batchSize; i++) {
+		const float* rowLogits = logits + (size_t)i * logitsStride;
+		const uint8_t* mask = actionMasks + (size_t)i * numActions;
+
+		int action;
+		if (deterministic) {
+			action = Native::MaskedArgmax(rowLogits, mask, numActions);
+		} else {
+			float* logProb = outLogProbs ? (outLogProbs + i) : NULL;
+			action = SampleMaskedLogits(rowLogits, mask, numActions, temperature, rngs ? rngs[i] : fallbackRNG, logProb);
+		}
+
+		if (action == -1) {
+			// Same as the softmax path, where a fully masked row becomes uniform
+			// Throwing here would take down a bot mid-match over one bad mask
+			static std::atomic<bool> loggedEmptyMask = false;
+			if (!loggedEmptyMask.exchange(true))
+				RG_LOG("SelectMaskedActions(): Action mask has no enabled actions, picking from all actions (only logged once)");
+
+			if (deterministic) {
+				action = 0;
+			} else {
+				FastRNG& rng = rngs ? rngs[i] : fallbackRNG;
+				action = RS_MIN((int)(rng.NextFloat() * numActions), numActions - 1);
+				if (outLogProbs)
+					outLogProbs[i] = -logf((float)numActions);
+			}
+		}
+
+		outActions[i] = action;
+	}
+}
+
+float GGL::CompareBackendLogits(InferenceBackend& a, InferenceBackend& b, int numSamples) {
+	RG_ASSERT(a.obsSize == b.obsSize && a.numActions == b.numActions);
+
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<float> dist(-1, 1);
+
+	std::vector<float> obs(a.obsSize);
+	std::vector<float> logitsA(a.numActions), logitsB(b.numActions);
+
+	float maxDiff = 0;
+	for (int i = 0; i < numSamples; i++) {
+		for (float& f : obs)
+			f = dist(rng);
+
+		a.InferLogits(obs.data(), 1, logitsA.data());
+		b.InferLogits(obs.data(), 1, logitsB.data());
+
+		for (int j = 0; j < a.numActions; j++)
+			maxDiff = RS_MAX(maxDiff, fabsf(logitsA[j] - logitsB[j]));
+	}
+
+	return maxDiff;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <GigaLearnCPP/InferenceModelConfig.h>
+#include <GigaLearnCPP/Sampler.h>
+#include <memory>
+
+namespace GGL {
+
+	class ModelSet;
+
+	enum class InferBackendType {
+		TORCH,        // Runs the torch::nn::Sequential models through libtorch
+		TORCH_JIT,    // Frozen TorchScript graph with libtorch's inference optimizations, cached next to the models
+		TORCH_ONEDNN, // libtorch's oneDNN kernels with weights prepacked at load, CPU only
+		NATIVE,       // Hand-written SIMD MLP kernels, CPU only
+		NATIVE_INT8   // Native kernels with INT8 weights and activations, CPU only
+	};
+
+	inline const char* GetInferBackendTypeName(InferBackendType type) {
+		switch (type) {
+		case InferBackendType::TORCH:        return "libtorch";
+		case InferBackendType::TORCH_JIT:    return "libtorch-jit";
+		case InferBackendType::TORCH_ONEDNN: return "libtorch-onednn";
+		case InferBackendType::NATIVE:       return "native";
+		case InferBackendType::NATIVE_INT8:  return "native-int8";
+		}
+		return "unknown";
+	}
+
+	enum class InferPrecision {
+		AUTO, // BF16 on CPUs with AVX512-BF16 or AMX, FP32 otherwise
+		FP32,
+		BF16  // bf16 weights and matmuls with fp32 accumulation (ignored by NATIVE_INT8)
+	};
+
+	inline const char* GetInferPrecisionName(InferPrecision precision) {
+		switch (precision) {
+		case InferPrecision::AUTO: return "auto";
+		case InferPrecision::FP32: return "fp32";
+		case InferPrecision::BF16: return "bf16";
+		}
+		return "unknown";
+	}
+
+	// Resolves AUTO to FP32 or BF16 for this machine
+	InferPrecision ResolveInferPrecision(InferPrecision precision, bool useGPU);
+
+	struct MemoryRegion {
+		const void* data;
+		size_t bytes;
+	};
+
+	// Runs shared_head + policy on a batch of observations
+	// All buffers are row-major host memory: obs is [batchSize, obsSize], masks and logits are [batchSize, numActions]
+	class InferenceBackend {
+	public:
+		int obsSize, numActions;
+		InferPrecision precision = InferPrecision::FP32;
+
+		InferenceBackend(int obsSize, int numActions) : obsSize(obsSize), numActions(numActions) {}
+		virtual ~InferenceBackend() = default;
+
+		virtual const char* GetName() const = 0;
+
+		// Host memory holding the weights, see Prefault()
+		virtual std::vector<MemoryRegion> GetWeightRegions() const { return {}; }
+
+		// Touches every page of the weights, so the first decision doesn't pay for page faults
+		void Prefault();
+
+		// Moves the weights into huge-page-aligned memory advised for transparent huge pages (see AdviseHugePageMemory())
+		// Returns the bytes moved, 0 if the backend doesn't own its weight memory (libtorch tensors, compiled-in weights)
+		// Call before Prefault() and before the backend is used from other threads
+		virtual size_t MoveWeightsToHugePages() { return 0; }
+
+		// True if inference reads the ModelSet the backend was built from, which then has to outlive it
+		// Otherwise the backend has its own copy of the weights and the models can be freed (see InferUnitConfig::leanMemory)
+		virtual bool NeedsModels() const { return false; }
+
+		// True if the forward pass runs on libtorch's intra-op thread pool (see InferUnitConfig::intraOpThreads)
+		virtual bool UsesIntraOpThreads() const { return false; }
+
+		// Raw policy logits (no mask or temperature applied)
+		virtual void InferLogits(const float* obs, int batchSize, float* outLogits) = 0;
+
+		// rngs is one generator per row for stochastic sampling, or NULL to use the backend's own
+		// outLogProbs is optional, and only filled when sampling (deterministic mode skips the softmax)
+		virtual void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) = 0;
+	};
+
+	// Models must already be loaded (not available in GGL_NO_TORCH builds)
+	std::unique_ptr<InferenceBackend> MakeInferenceBackend(
+		InferBackendType type, ModelSet& models, int obsSize, int numActions, bool useGPU,
+		InferPrecision precision = InferPrecision::FP32
+	);
+
+	// Reads one byte per page of [data, data + bytes)
+	void PrefaultMemory(const void* data, size_t bytes);
+
+	// Masked argmax or sampling over host logits with row stride logitsStride, shared by the CPU-side backends
+	// Rows without a per-row generator in rngs use fallbackRNG
+	// A row with no enabled actions gets action 0 (deterministic) or a uniform pick over all actions (sampling)
+	void SelectMaskedActions(
+		const float* logits, int logitsStride, const uint8_t* actionMasks, int batchSize, int numActions,
+		bool deterministic, float temperature,
+		int* outActions, float* outLogProbs, FastRNG* rngs, FastRNG& fallbackRNG
+	);
+
+	// Feeds both backends the same random observations, returns the largest absolute logit difference
+	float CompareBackendLogits(InferenceBackend& a, InferenceBackend& b, int numSamples = 64);
+}
@@ -1,6 +1,9 @@
 #include <GigaLearnCPP/InferenceModels.h>
 
 #include <GigaLearnCPP/Models.h>
+#include <GigaLearnCPP/NativeKernels.h>
+
+#include <random>
 
 namespace {
 
@@ -20,10 +23,7 @@ namespace {
 		// Guard against bad temperature
 		if (!(temperature > 0.f)) temperature = 1.f;
 
-		if (models["shared_head"])
-			obs = models["shared_head"]->Forward(obs, halfPrec);
-
-		auto logits = models["policy"]->Forward(obs, halfPrec) / temperature;
+		auto logits = GGL::Infer::InferLogits(models, obs, halfPrec) / temperature;
 
 		auto probs = torch::softmax(
 			logits + ACTION_DISABLED_LOGIT * actionMasks.logical_not(),
@@ -36,6 +36,78 @@ namespace {
 			.clamp(ACTION_MIN_PROB, 1.0f);
 	}
 
+	// Argmax over the raw logits, honoring the mask
+	// Temperature and softmax don't change the argmax, so they're skipped entirely
+	torch::Tensor InferDeterministicActions(
+		GGL::ModelSet& models,
+		torch::Tensor obs,
+		torch::Tensor actionMasks,
+		bool halfPrec
+	) {
+		auto logits = GGL::Infer::InferLogits(models, obs, halfPrec);
+
+		if (!logits.is_cpu())
+			return logits.masked_fill(actionMasks.to(torch::kBool).logical_not(), -INFINITY).argmax(1);
+
+		logits = logits.to(torch::kFloat).contiguous();
+		actionMasks = actionMasks.to(torch::kUInt8).contiguous();
+
+		int batchSize = (int)logits.size(0);
+		int numActions = (int)logits.size(1);
+		const float* logitsData = logits.data_ptr<float>();
+		const uint8_t* maskData = actionMasks.data_ptr<uint8_t>();
+
+		auto actions = torch::empty({ batchSize }, torch::kLong);
+		int64_t* actionsData = actions.data_ptr<int64_t>();
+		for (int i = 0; i < batchSize; i++) {
+			int action = GGL::Native::MaskedArgmax(logitsData + (size_t)i * numActions, maskData + (size_t)i * numActions, numActions);
+
+			// Same as the softmax path, where a fully masked row becomes uniform
+			actionsData[i] = RS_MAX(action, 0);
+		}
+
+		return actions;
+	}
+
+	void SampleActionsCPU(
+		GGL::ModelSet& models,
+		torch::Tensor obs,
+		torch::Tensor actionMasks,
+		float temperature,
+		bool halfPrec,
+		GGL::FastRNG* rngs,
+		torch::Tensor* outActions,
+		torch::Tensor* outLogProbs
+	) {
+		thread_local GGL::FastRNG threadRNG(std::random_device{}());
+
+		auto logits = GGL::Infer::InferLogits(models, obs, halfPrec).to(torch::kFloat).contiguous();
+		actionMasks = actionMasks.to(torch::kUInt8).contiguous();
+
+		int batchSize = (int)logits.size(0);
+		int numActions = (int)logits.size(1);
+		const float* logitsData = logits.data_ptr<float>();
+		const uint8_t* maskData = actionMasks.data_ptr<uint8_t>();
+
+		auto actions = torch::empty({ batchSize }, torch::kLong);
+		auto logProbs = outLogProbs ? torch::empty({ batchSize }, torch::kFloat) : torch::Tensor();
+		int64_t* actionsData = actions.data_ptr<int64_t>();
+		float* logProbsData = outLogProbs ? logProbs.data_ptr<float>() : NULL;
+
+		for (int i = 0; i < batchSize; i++) {
+			int action = GGL::SampleMaskedLogits(
+				logitsData + (size_t)i * numActions, maskData + (size_t)i * numActions, numActions,
+				temperature, rngs ? rngs[i] : threadRNG, logProbsData ? (logProbsData + i) : NULL
+			);
+
+			// Same as the softmax path, where a fully masked row becomes uniform
+			actionsData[i] = RS_MAX(action, 0);
+		}
+
+		if (outActions)  *outActions = actions;
+		if (outLogProbs) *outLogProbs = logProbs;
+	}
+
 } // anonymous namespace
 
 namespace GGL::Infer {
@@ -69,6 +141,17 @@ namespace GGL::Infer {
 		outModels.Add(new Model("policy", fullPolicyConfig, device));
 	}
 
+	torch::Tensor InferLogits(
+		ModelSet& models,
+		torch::Tensor obs,
+		bool halfPrec
+	) {
+		if (models["shared_head"])
+			obs = models["shared_head"]->Forward(obs, halfPrec);
+
+		return models["policy"]->Forward(obs, halfPrec);
+	}
+
 	void InferActions(
 		ModelSet& models,
 		torch::Tensor obs,
@@ -77,21 +160,23 @@ namespace GGL::Infer {
 		float temperature,
 		bool halfPrec,
 		torch::Tensor* outActions,
-		torch::Tensor* outLogProbs
+		torch::Tensor* outLogProbs,
+		FastRNG* rngs
 	) {
-		auto probs = InferPolicyProbsFromModels(models, obs, actionMasks, temperature, halfPrec);
-
 		if (deterministic) {
-			auto action = probs.argmax(1);
-			if (outActions)  *outActions = action.flatten();
+			auto action = InferDeterministicActions(models, obs, actionMasks, halfPrec);
+			if (outActions)  *outActions = action;
 			if (outLogProbs) *outLogProbs = torch::Tensor(); // empty
 		}
+		else if (obs.is_cpu()) {
+			SampleActionsCPU(models, obs, actionMasks, temperature, halfPrec, rngs, outActions, outLogProbs);
+		}
 		else {
+			auto probs = InferPolicyProbsFromModels(models, obs, actionMasks, temperature, halfPrec);
 			auto action = torch::multinomial(probs, 1, true);
-			auto logProb = torch::log(probs).gather(-1, action);
 
 			if (outActions)  *outActions = action.flatten();
-			if (outLogProbs) *outLogProbs = logProb.flatten();
+			if (outLogProbs) *outLogProbs = torch::log(probs).gather(-1, action).flatten();
 		}
 	}
 
@@ -2,6 +2,7 @@
 
 #include <torch/torch.h>
 #include <GigaLearnCPP/InferenceModelConfig.h>
+#include <GigaLearnCPP/Sampler.h>
 
 namespace GGL {
 	class ModelSet;
@@ -19,6 +20,15 @@ namespace GGL::Infer {
 		ModelSet& outModels
 	);
 
+	// Raw policy logits, before masking or temperature
+	torch::Tensor InferLogits(
+		ModelSet& models,
+		torch::Tensor obs,
+		bool halfPrec
+	);
+
+	// On CPU, sampling uses SampleMaskedLogits() with one generator per row from rngs (or a per-thread one if NULL)
+	// On GPU, it stays on torch::multinomial
 	void InferActions(
 		ModelSet& models,
 		torch::Tensor obs,
@@ -27,7 +37,8 @@ namespace GGL::Infer {
 		float temperature,
 		bool halfPrec,
 		torch::Tensor* outActions,
-		torch::Tensor* outLogProbs
+		torch::Tensor* outLogProbs,
+		FastRNG* rngs = NULL
 	);
 
 } // namespace GGL::Infer
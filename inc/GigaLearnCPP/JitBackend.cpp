@@ -0,0 +1,194 @@
+#include "JitBackend.h"
+#include "Hash.h"
+
+#include <GigaLearnCPP/Models.h>
+#include <GigaLearnCPP/InferPlan.h>
+
+#include <torch/version.h>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+using namespace GGL;
+
+namespace {
+	constexpr const char* CACHE_KEY_FILE = "ggl_cache_key";
+
+	// Identifies the weights, layout, libtorch version and device a frozen module was built for
+	std::string MakeCacheKey(const Native::Network& network, torch::Device device) {
+		uint64_t hash = FNV_OFFSET_BASIS;
+		for (auto& layer : network.layers) {
+			HashValue(hash, layer.type);
+			HashValue(hash, layer.inSize);
+			HashValue(hash, layer.outSize);
+			HashValue(hash, layer.eps);
+			HashValue(hash, layer.activationType);
+			HashValue(hash, layer.negativeSlope);
+			HashBytes(hash, layer.weight.data(), layer.weight.size() * sizeof(float));
+			HashBytes(hash, layer.bias.data(), layer.bias.size() * sizeof(float));
+		}
+
+		std::stringstream stream;
+		stream << std::hex << hash << std::dec <<
+			"-torch" << TORCH_VERSION_MAJOR << "." << TORCH_VERSION_MINOR << "." << TORCH_VERSION_PATCH <<
+			"-" << c10::DeviceTypeName(device.type());
+		return stream.str();
+	}
+
+	const char* GetActivationScriptFunc(ModelActivationType type) {
+		switch (type) {
+		case ModelActivationType::RELU:       return "torch.relu";
+		case ModelActivationType::LEAKY_RELU: return "torch.leaky_relu";
+		case ModelActivationType::SIGMOID:    return "torch.sigmoid";
+		case ModelActivationType::TANH:       return "torch.tanh";
+		}
+		RG_ERR_CLOSE("JitInferenceBackend: Unknown activation function type: " << (int)type);
+	}
+}
+
+torch::jit::Module GGL::JitInferenceBackend::BuildFrozenModule(const Native::Network& network, torch::Device device) {
+	torch::jit::Module scripted("GGLPolicy");
+
+	// Floats are written with enough digits to round-trip exactly
+	std::stringstream src;
+	src << std::scientific << std::setprecision(9);
+	src << "def forward(self, x):\n";
+
+	for (size_t i = 0; i < network.layers.size(); i++) {
+		auto& layer = network.layers[i];
+		std::string weightName = "l" + std::to_string(i) + "_weight";
+		std::string biasName = "l" + std::to_string(i) + "_bias";
+
+		switch (layer.type) {
+		case Native::Layer::Type::LINEAR:
+			scripted.register_parameter(weightName, PTR_TO_TENSOR(layer.weight.data(), { layer.outSize, layer.inSize }).to(device), false);
+			if (!layer.bias.empty()) {
+				scripted.register_parameter(biasName, PTR_TO_TENSOR(layer.bias.data(), { layer.outSize }).to(device), false);
+				src << "    x = torch.linear(x, self." << weightName << ", self." << biasName << ")\n";
+			} else {
+				src << "    x = torch.linear(x, self." << weightName << ")\n";
+			}
+			break;
+
+		case Native::Layer::Type::LAYER_NORM:
+			scripted.register_parameter(weightName, PTR_TO_TENSOR(layer.weight.data(), { layer.outSize }).to(device), false);
+			scripted.register_parameter(biasName, PTR_TO_TENSOR(layer.bias.data(), { layer.outSize }).to(device), false);
+			src <<
+				"    x = torch.layer_norm(x, [" << layer.outSize << "], self." << weightName << ", self." << biasName <<
+				", " << (double)layer.eps << ")\n";
+			break;
+
+		case Native::Layer::Type::ACTIVATION:
+			src << "    x = " << GetActivationScriptFunc(layer.activationType) << "(x";
+			if (layer.activationType == ModelActivationType::LEAKY_RELU)
+				src << ", " << (double)layer.negativeSlope;
+			src << ")\n";
+			break;
+		}
+	}
+
+	src << "    return x\n";
+
+	scripted.define(src.str());
+	scripted.eval();
+
+	// Parameters become constants, which lets the optimization passes fold and fuse around them
+	return torch::jit::freeze(scripted);
+}
+
+std::filesystem::path GGL::JitInferenceBackend::GetCachePath(ModelSet& models) {
+	auto policy = models["policy"];
+	if (!policy || policy->loadedPath.empty())
+		return {};
+
+	return policy->GetSuffixedSavePath(policy->loadedPath.parent_path(), "_FROZEN").replace_extension(".pt");
+}
+
+GGL::JitInferenceBackend::JitInferenceBackend(ModelSet& models, int obsSize, int numActions, bool useGPU) :
+	InferenceBackend(obsSize, numActions), useGPU(useGPU), _rng(std::random_device{}()) {
+
+	RG_NO_GRAD;
+
+	torch::Device device = useGPU ? torch::kCUDA : torch::kCPU;
+
+	Native::Network network = {};
+	if (models["shared_head"])
+		network.AppendModel(*models["shared_head"]);
+	network.AppendModel(*models["policy"]);
+
+	if (network.numInputs != obsSize || network.numOutputs != numActions) {
+		RG_ERR_CLOSE(
+			"JitInferenceBackend: Network maps " << network.numInputs << " -> " << network.numOutputs <<
+			", expected " << obsSize << " -> " << numActions
+		);
+	}
+
+	std::string cacheKey = MakeCacheKey(network, device);
+	auto cachePath = GetCachePath(models);
+
+	if (!cachePath.empty() && std::filesystem::exists(cachePath)) {
+		try {
+			torch::jit::ExtraFilesMap extraFiles = { { CACHE_KEY_FILE, "" } };
+			auto cached = torch::jit::load(cachePath.string(), device, extraFiles);
+			if (extraFiles[CACHE_KEY_FILE] == cacheKey) {
+				module = cached;
+				loadedFromCache = true;
+			} else {
+				RG_LOG("JitInferenceBackend: Cached module " << cachePath << " is outdated, rebuilding it");
+			}
+		}
+		catch (std::exception& e) {
+			RG_LOG("JitInferenceBackend: Failed to load cached module " << cachePath << ", rebuilding it\nException: " << e.what());
+		}
+	}
+
+	if (!loadedFromCache) {
+		module = BuildFrozenModule(network, device);
+
+		if (!cachePath.empty()) {
+			try {
+				module.save(cachePath.string(), { { CACHE_KEY_FILE, cacheKey } });
+			}
+			catch (std::exception& e) {
+				RG_LOG("JitInferenceBackend: Failed to save cached module to " << cachePath << "\nException: " << e.what());
+			}
+		}
+	}
+
+	// Not part of the cache, the result holds device-specific (MKLDNN) weight layouts that don't serialize
+	module = torch::jit::optimize_for_inference(module);
+
+	// The profiling executor only specializes the graph after a few runs, get those out of the way now
+	std::vector<float> warmupObs(obsSize);
+	_logits.resize(numActions);
+	for (int i = 0; i < 3; i++)
+		InferLogits(warmupObs.data(), 1, _logits.data());
+
+	if (loadedFromCache) {
+		RG_LOG("JitInferenceBackend: Loaded frozen module from " << cachePath << ", running on " << (useGPU ? "GPU" : "CPU"));
+	} else {
+		RG_LOG("JitInferenceBackend: Built frozen module, running on " << (useGPU ? "GPU" : "CPU"));
+	}
+}
+
+void GGL::JitInferenceBackend::InferLogits(const float* obs, int batchSize, float* outLogits) {
+	RG_NO_GRAD;
+
+	auto device = useGPU ? torch::kCUDA : torch::kCPU;
+	auto tObs = PTR_TO_TENSOR_VIEW(obs, batchSize, obsSize).to(device);
+
+	auto logits = module.forward({ tObs }).toTensor().contiguous().cpu().to(torch::kFloat);
+	memcpy(outLogits, logits.data_ptr<float>(), (size_t)batchSize * numActions * sizeof(float));
+}
+
+void GGL::JitInferenceBackend::InferActions(
+	const float* obs, const uint8_t* actionMasks, int batchSize,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	if (_logits.size() < (size_t)batchSize * numActions)
+		_logits.resize((size_t)batchSize * numActions);
+
+	InferLogits(obs, batchSize, _logits.data());
+	SelectMaskedActions(_logits.data(), numActions, actionMasks, batchSize, numActions, deterministic, temperature, outActions, outLogProbs, rngs, _rng);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "InferenceBackend.h"
+#include "NativeKernels.h"
+
+#include <torch/script.h>
+#include <filesystem>
+
+namespace GGL {
+
+	namespace Native {
+		struct Network;
+	}
+
+	// Scripts shared_head + policy into one TorchScript graph, freezes it and runs torch::jit::optimize_for_inference()
+	// The frozen module is cached next to the .lt files (see GetCachePath()), so later startups skip scripting and freezing
+	class JitInferenceBackend : public InferenceBackend {
+	public:
+		bool useGPU;
+		torch::jit::Module module;
+
+		// True if the frozen module came from the cache instead of being built this run
+		bool loadedFromCache = false;
+
+		JitInferenceBackend(ModelSet& models, int obsSize, int numActions, bool useGPU);
+
+		virtual const char* GetName() const override { return "libtorch-jit"; }
+
+		virtual bool UsesIntraOpThreads() const override { return !useGPU; }
+
+		// Empty if the policy wasn't loaded from a file
+		static std::filesystem::path GetCachePath(ModelSet& models);
+
+		virtual void InferLogits(const float* obs, int batchSize, float* outLogits) override;
+
+		virtual void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) override;
+
+	private:
+		Native::AlignedVec<float> _logits;
+		FastRNG _rng;
+
+		// Scripts and freezes the network, this is the part the cache skips
+		static torch::jit::Module BuildFrozenModule(const Native::Network& network, torch::Device device);
+	};
+}
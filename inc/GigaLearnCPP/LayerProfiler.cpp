@@ -0,0 +1,93 @@
+#include "LayerProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+	// Per layer, past this only the means keep updating until the next Reset()
+	constexpr size_t MAX_SAMPLES = 1 << 18;
+}
+
+void GGL::LayerProfiler::AddLayer(const std::string& name, double flopsPerRow) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	Layer layer = {};
+	layer.name = name;
+	layer.flopsPerRow = flopsPerRow;
+	_layers.push_back(std::move(layer));
+}
+
+void GGL::LayerProfiler::Record(int layerIndex, double us, int numRows) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& layer = _layers[layerIndex];
+	layer.numCalls++;
+	layer.numRows += numRows;
+	layer.totalUs += us;
+	if (layer.samplesUs.size() < MAX_SAMPLES)
+		layer.samplesUs.push_back((float)us);
+}
+
+std::vector<GGL::LayerProfileStats> GGL::LayerProfiler::GetStats() {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	double modelTotalUs = 0;
+	for (auto& layer : _layers)
+		modelTotalUs += layer.totalUs;
+
+	std::vector<LayerProfileStats> result;
+	for (auto& layer : _layers) {
+		LayerProfileStats stats = {};
+		stats.name = layer.name;
+		stats.numCalls = layer.numCalls;
+
+		if (layer.numCalls > 0) {
+			stats.meanUs = layer.totalUs / layer.numCalls;
+
+			std::vector<float> sorted = layer.samplesUs;
+			size_t index = (size_t)(0.99 * (sorted.size() - 1) + 0.5);
+			std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+			stats.p99Us = sorted[index];
+
+			// FLOP per microsecond * 1e-3 = GFLOP/s
+			if (layer.totalUs > 0)
+				stats.gflops = (layer.flopsPerRow * layer.numRows) / layer.totalUs * 1e-3;
+		}
+
+		if (modelTotalUs > 0)
+			stats.timeFraction = layer.totalUs / modelTotalUs;
+
+		result.push_back(stats);
+	}
+	return result;
+}
+
+void GGL::LayerProfiler::Log() {
+	auto allStats = GetStats();
+	if (allStats.empty() || allStats[0].numCalls == 0) {
+		RG_LOG("LayerProfiler: No forward passes of \"" << modelName << "\" recorded");
+		return;
+	}
+
+	std::stringstream table;
+	table << std::fixed << std::setprecision(2);
+	for (size_t i = 0; i < allStats.size(); i++) {
+		auto& stats = allStats[i];
+		table <<
+			"\n  " << std::setw(2) << i << " " << std::left << std::setw(24) << stats.name << std::right <<
+			" mean " << std::setw(8) << stats.meanUs << "us, p99 " << std::setw(8) << stats.p99Us << "us, " <<
+			std::setw(6) << (stats.timeFraction * 100) << "% of time";
+		if (stats.gflops > 0)
+			table << ", " << std::setw(7) << stats.gflops << " GFLOP/s";
+	}
+
+	RG_LOG("LayerProfiler: \"" << modelName << "\" over " << allStats[0].numCalls << " forward passes:" << table.str());
+}
+
+void GGL::LayerProfiler::Reset() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto& layer : _layers) {
+		layer.numCalls = layer.numRows = 0;
+		layer.totalUs = 0;
+		layer.samplesUs.clear();
+	}
+}
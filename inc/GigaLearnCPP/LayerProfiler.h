@@ -0,0 +1,44 @@
+#pragma once
+
+#include <RLGymCPP/Framework.h>
+#include <mutex>
+
+namespace GGL {
+
+	struct LayerProfileStats {
+		std::string name;
+		uint64_t numCalls = 0;
+		double meanUs = 0, p99Us = 0;
+		double gflops = 0; // Achieved GFLOP/s over all calls
+		double timeFraction = 0; // Share of the model's total profiled time
+	};
+
+	// Collects per-layer timings of a model's forward passes (see Model::EnableProfiling())
+	// Thread-safe, so models shared by several bots can be profiled
+	class LayerProfiler {
+	public:
+		std::string modelName;
+
+		// flopsPerRow is the approximate floating-point work of the layer for one input row
+		void AddLayer(const std::string& name, double flopsPerRow);
+
+		void Record(int layerIndex, double us, int numRows);
+
+		std::vector<LayerProfileStats> GetStats();
+		void Log();
+		void Reset();
+
+	private:
+		struct Layer {
+			std::string name;
+			double flopsPerRow;
+
+			uint64_t numCalls = 0, numRows = 0;
+			double totalUs = 0;
+			std::vector<float> samplesUs; // Capped, see MAX_SAMPLES in LayerProfiler.cpp
+		};
+
+		std::mutex _mutex;
+		std::vector<Layer> _layers;
+	};
+}
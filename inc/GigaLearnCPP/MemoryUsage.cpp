@@ -0,0 +1,85 @@
+#include "MemoryUsage.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2 // K32GetProcessMemoryInfo, no psapi.lib needed
+#include <Windows.h>
+#include <Psapi.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#endif
+
+GGL::MemoryUsage GGL::GetMemoryUsage() {
+	MemoryUsage result = {};
+
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		result.rssBytes = counters.WorkingSetSize;
+		result.peakRssBytes = counters.PeakWorkingSetSize;
+	}
+#elif defined(__linux__)
+	// Lines look like "VmRSS:     12345 kB"
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		size_t* target = NULL;
+		if (line.rfind("VmRSS:", 0) == 0) {
+			target = &result.rssBytes;
+		} else if (line.rfind("VmHWM:", 0) == 0) {
+			target = &result.peakRssBytes;
+		}
+
+		if (target)
+			*target = (size_t)std::stoull(line.substr(6)) * 1024;
+	}
+#endif
+
+	return result;
+}
+
+void GGL::ReleaseFreeMemory() {
+#ifdef _WIN32
+	_heapmin();
+#elif defined(__GLIBC__)
+	malloc_trim(0);
+#endif
+}
+
+bool GGL::AreHugePagesEnabled() {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	// Looks like "always [madvise] never", with the active mode in brackets
+	std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+	std::string modes;
+	std::getline(file, modes);
+	return modes.find("[always]") != std::string::npos || modes.find("[madvise]") != std::string::npos;
+#else
+	return false;
+#endif
+}
+
+size_t GGL::AdviseHugePageMemory(const void* data, size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	// madvise() needs page-aligned bounds, so only the pages fully inside the range are advised
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	uintptr_t start = ((uintptr_t)data + pageSize - 1) / pageSize * pageSize;
+	uintptr_t end = ((uintptr_t)data + bytes) / pageSize * pageSize;
+	if (end <= start)
+		return 0;
+
+	if (madvise((void*)start, end - start, MADV_HUGEPAGE) != 0)
+		return 0;
+
+	return end - start;
+#else
+	return 0;
+#endif
+}
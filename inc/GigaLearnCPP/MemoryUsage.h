@@ -0,0 +1,32 @@
+#pragma once
+
+#include <RLGymCPP/Framework.h>
+
+namespace GGL {
+
+	struct MemoryUsage {
+		size_t rssBytes = 0;     // Resident set (working set on Windows)
+		size_t peakRssBytes = 0;
+	};
+
+	// Zeros if the platform doesn't report it
+	MemoryUsage GetMemoryUsage();
+
+	// Returns freed heap memory to the OS (e.g. loader buffers left behind by torch::load)
+	// The allocator otherwise keeps it mapped and it counts towards RSS
+	void ReleaseFreeMemory();
+
+	constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+	// Asks for transparent huge pages on [data, data + bytes), returns the number of bytes advised
+	// Only whole HUGE_PAGE_SIZE-aligned extents inside the range can end up on huge pages, and only pages first touched
+	// after the advice are faulted in as huge pages (khugepaged may collapse older ones eventually)
+	size_t AdviseHugePageMemory(const void* data, size_t bytes);
+
+	// True on Linux with THP set to "madvise" or "always"
+	bool AreHugePagesEnabled();
+
+	inline double BytesToMB(size_t bytes) {
+		return bytes / (1024.0 * 1024.0);
+	}
+}
@@ -3,8 +3,11 @@
 #include <RLGymCPP/Framework.h>
 #include <GigaLearnCPP/FrameworkTorch.h>
 #include <GigaLearnCPP/InferenceModelConfig.h>
+#include <GigaLearnCPP/FlatWeights.h>
+#include <GigaLearnCPP/LayerProfiler.h>
 
 #include <torch/torch.h>
+#include <chrono>
 
 namespace GGL {
 
@@ -25,12 +28,34 @@ namespace GGL {
 		return out;
 	}
 
+	// Name and approximate FLOPs per input row of one Sequential layer, inSize is the width coming into it
+	inline void DescribeSeqLayer(const torch::nn::AnyModule& mod, int64_t inSize, std::string& outName, double& outFlopsPerRow, int64_t& outSize) {
+		outSize = inSize;
+		if (auto linear = mod.ptr()->as<torch::nn::Linear>()) {
+			outSize = linear->options.out_features();
+			outName = "Linear(" + std::to_string(inSize) + "->" + std::to_string(outSize) + ")";
+			outFlopsPerRow = 2.0 * inSize * outSize;
+		} else if (mod.ptr()->as<torch::nn::LayerNorm>()) {
+			outName = "LayerNorm(" + std::to_string(inSize) + ")";
+			outFlopsPerRow = 7.0 * inSize; // Mean, variance, normalize, scale and shift
+		} else {
+			// Activations are named like "torch::nn::ReLUImpl"
+			outName = mod.ptr()->name();
+			if (outName.rfind("torch::nn::", 0) == 0)
+				outName = outName.substr(11);
+			if (outName.size() > 4 && outName.compare(outName.size() - 4, 4, "Impl") == 0)
+				outName.resize(outName.size() - 4);
+			outFlopsPerRow = (double)inSize;
+		}
+	}
+
 	class Model : public torch::nn::Module {
 	public:
 		std::string modelName;
 		torch::Device device = torch::kCPU;
 
 		// Main network + optional bf16 mirror for faster inference
+		// The mirror is only created the first time it's needed (see UpdateHalfMirror())
 		torch::nn::Sequential seq{ nullptr };
 		torch::nn::Sequential seqHalf{ nullptr };
 		bool _seqHalfOutdated = true;
@@ -38,8 +63,19 @@ namespace GGL {
 		// Needed by InferenceModels.cpp (uses config.numOutputs)
 		ModelConfig config = InferPartialModelConfig{};
 
+		// File this model was last loaded from, empty if it was never loaded
+		std::filesystem::path loadedPath = {};
+
+		// Per-layer timings of Forward(), NULL unless EnableProfiling() was called
+		std::unique_ptr<LayerProfiler> profiler;
+
 		Model() = default;
 
+		~Model() {
+			if (profiler)
+				profiler->Log();
+		}
+
 		Model(const char* name, const ModelConfig& cfg, torch::Device dev)
 			: modelName(name ? name : ""), device(dev), config(cfg) {
 
@@ -47,7 +83,6 @@ namespace GGL {
 				RG_ERR_CLOSE("Failed to create model \"" << modelName << "\" with invalid config");
 
 			seq = register_module("seq", torch::nn::Sequential());
-			seqHalf = register_module("seqHalf", torch::nn::Sequential());
 
 			int lastSize = config.numInputs;
 
@@ -86,6 +121,11 @@ namespace GGL {
 			return GetSuffixedSavePath(folder, "");
 		}
 
+		// Flat weight file converted from the .lt by GGLFlatten (see FlatWeights.h)
+		std::filesystem::path GetFlatSavePath(const std::filesystem::path& folder) const {
+			return GetSavePath(folder).replace_extension(".ggw");
+		}
+
 		static std::filesystem::path FindModelFile(const std::filesystem::path& folder, const std::string& nameUpperLt) {
 			auto pUpper = folder / nameUpperLt;
 			if (std::filesystem::exists(pUpper)) return pUpper;
@@ -98,45 +138,152 @@ namespace GGL {
 			return pUpper; // default (for error message)
 		}
 
+		// Creates or refreshes the bf16 mirror if seq changed since it was last built
+		void UpdateHalfMirror() {
+			if (!_seqHalfOutdated)
+				return;
+			_seqHalfOutdated = false;
+
+			RG_NO_GRAD;
+
+			if (!seqHalf) {
+				seqHalf = torch::nn::Sequential();
+				for (auto& mod : *seq)
+					seqHalf->push_back(mod.clone());
+				seqHalf->to(RG_HALFPERC_TYPE, true);
+			}
+			else {
+				auto fromParams = seq->parameters(true);
+				auto toParams = seqHalf->parameters(true);
+				RG_ASSERT(fromParams.size() == toParams.size());
+
+				for (int i = 0; i < (int)fromParams.size(); i++) {
+					auto scaled = fromParams[i].to(RG_HALFPERC_TYPE, true);
+					toParams[i].copy_(scaled, true);
+				}
+			}
+		}
+
 		torch::Tensor Forward(torch::Tensor input, bool halfPrec) {
 			// In inference builds, gradients should be off; but guard anyway.
 			if (torch::GradMode::is_enabled())
 				halfPrec = false;
 
 			if (!halfPrec) {
-				return seq->forward(input);
+				return profiler ? ForwardProfiled(seq, input) : seq->forward(input);
 			}
 
-			// Build/refresh bf16 mirror if needed
-			if (_seqHalfOutdated) {
-				_seqHalfOutdated = false;
-
-				if (seqHalf->size() == 0) {
-					for (auto& mod : *seq)
-						seqHalf->push_back(mod.clone());
-					seqHalf->to(RG_HALFPERC_TYPE, true);
-				}
-				else {
-					auto fromParams = seq->parameters(true);
-					auto toParams = seqHalf->parameters(true);
-					RG_ASSERT(fromParams.size() == toParams.size());
-
-					for (int i = 0; i < (int)fromParams.size(); i++) {
-						auto scaled = fromParams[i].to(RG_HALFPERC_TYPE, true);
-						toParams[i].copy_(scaled, true);
-					}
-				}
-			}
+			UpdateHalfMirror();
 
 			auto halfInput = input.to(RG_HALFPERC_TYPE);
-			auto halfOut = seqHalf->forward(halfInput);
+			auto halfOut = profiler ? ForwardProfiled(seqHalf, halfInput) : seqHalf->forward(halfInput);
 			return halfOut.to(torch::kFloat);
 		}
 
-		void Load(const std::filesystem::path& folder, bool allowNotExist) {
+		// Times every layer of Forward() from now on, the report is logged when the model is freed (or on profiler->Log())
+		// NOTE: Only the TORCH backend runs through Forward(), the others build their own copy of the network
+		void EnableProfiling() {
+			if (profiler)
+				return;
+
+			profiler = std::make_unique<LayerProfiler>();
+			profiler->modelName = modelName;
+
+			int64_t size = config.numInputs;
+			for (auto& mod : *seq) {
+				std::string name;
+				double flopsPerRow;
+				DescribeSeqLayer(mod, size, name, flopsPerRow, size);
+				profiler->AddLayer(name, flopsPerRow);
+			}
+		}
+
+		// Runs the layers one by one, timing each
+		torch::Tensor ForwardProfiled(torch::nn::Sequential& net, torch::Tensor x) {
+			int numRows = (x.dim() > 1) ? (int)x.size(0) : 1;
+
+			int layerIndex = 0;
+			for (auto& mod : *net) {
+				auto startTime = std::chrono::steady_clock::now();
+				x = mod.forward(x);
+
+				// CUDA kernels are asynchronous, so a layer is only timed once it has actually run
+				if (x.is_cuda())
+					torch::cuda::synchronize();
+
+				double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+				profiler->Record(layerIndex++, us, numRows);
+			}
+			return x;
+		}
+
+		// The parameters end up pointing straight into the file's read-only mapping, nothing is parsed or copied (on CPU)
+		// Inference never writes to them, anything that does (e.g. an optimizer step) faults instead of silently unsharing pages
+		void LoadFlat(const std::filesystem::path& path) {
+			FlatWeightsFile file;
+			try {
+				file = FlatWeightsFile::Open(path);
+			}
+			catch (const std::exception& e) {
+				RG_ERR_CLOSE("Failed to load model \"" << modelName << "\" from " << path << "\nException: " << e.what());
+			}
+
+			if (file.configHash != HashModelConfig(config)) {
+				RG_ERR_CLOSE(
+					"Flat weights " << path << " for model \"" << modelName << "\" were converted with a different config.\n"
+					"Make sure your config (layer sizes / layernorm / activation / output layer) matches the one given to GGLFlatten."
+				);
+			}
+
+			RG_NO_GRAD;
+
+			auto params = seq->named_parameters(true);
+			if (params.size() != file.tensors.size())
+				RG_ERR_CLOSE("Flat weights " << path << " have " << file.tensors.size() << " tensors, model \"" << modelName << "\" has " << params.size());
+
+			for (auto& param : params) {
+				auto view = file.Find(param.key());
+				if (!view || view->shape != param.value().sizes().vec())
+					RG_ERR_CLOSE("Flat weights " << path << " are missing \"" << param.key() << "\" or it has the wrong shape");
+
+				// The deleter keeps the mapping alive for as long as the tensor is
+				auto mapping = file.mapping;
+				auto tensor = torch::from_blob(const_cast<float*>(view->data), view->shape, [mapping](void*) {}, torch::kFloat);
+				param.value().set_data(device.is_cpu() ? tensor : tensor.to(device));
+			}
+
+			loadedPath = path;
+			_seqHalfOutdated = true;
+		}
+
+		void SaveFlat(const std::filesystem::path& folder) const {
+			std::vector<torch::Tensor> cpuParams;
+			std::vector<FlatTensorSource> sources;
+			for (auto& param : seq->named_parameters(true)) {
+				auto tensor = param.value().detach().to(torch::kCPU, torch::kFloat).contiguous();
+				cpuParams.push_back(tensor);
+				sources.push_back({ param.key(), tensor.sizes().vec(), tensor.data_ptr<float>() });
+			}
+
+			WriteFlatWeights(GetFlatSavePath(folder), HashModelConfig(config), sources);
+		}
+
+		// If allowFlat, a flat weight file next to the .lt is used instead (see LoadFlat())
+		void Load(const std::filesystem::path& folder, bool allowNotExist, bool allowFlat = true) {
 			auto expectedName = GetSavePath(folder).filename().string();
 			auto path = FindModelFile(folder, expectedName);
 
+			// Prefer the flat file, unless the .lt changed after it was converted
+			auto flatPath = FindModelFile(folder, GetFlatSavePath(folder).filename().string());
+			if (allowFlat && std::filesystem::exists(flatPath)) {
+				if (std::filesystem::exists(path) && std::filesystem::last_write_time(path) > std::filesystem::last_write_time(flatPath)) {
+					RG_LOG("Warning: " << path << " is newer than " << flatPath << ", loading the .lt instead (run GGLFlatten again)");
+				} else {
+					LoadFlat(flatPath);
+					return;
+				}
+			}
+
 			if (!std::filesystem::exists(path)) {
 				if (allowNotExist) {
 					RG_LOG("Warning: Model \"" << modelName << "\" not found in " << folder << " (skipping)");
@@ -167,6 +314,7 @@ namespace GGL {
 				);
 			}
 
+			loadedPath = path;
 			_seqHalfOutdated = true;
 		}
 	};
@@ -191,6 +339,24 @@ namespace GGL {
 				kv.second->Load(folder, allowNotExist);
 		}
 
+		// See Model::EnableProfiling()
+		void EnableProfiling() {
+			for (auto& kv : map)
+				kv.second->EnableProfiling();
+		}
+
+		void LogProfiles() {
+			for (auto& kv : map)
+				if (kv.second->profiler)
+					kv.second->profiler->Log();
+		}
+
+		void ResetProfiles() {
+			for (auto& kv : map)
+				if (kv.second->profiler)
+					kv.second->profiler->Reset();
+		}
+
 		void Free() {
 			for (auto& kv : map)
 				delete kv.second;
@@ -0,0 +1,147 @@
+#include "NativeBackend.h"
+
+#include "MemoryUsage.h"
+
+#include <GigaLearnCPP/Models.h>
+
+#include <random>
+
+using namespace GGL;
+
+namespace {
+	// Smaller arenas stay where they are, a whole huge page for them would cost more memory than their TLB misses
+	constexpr size_t MIN_HUGE_PAGE_ARENA_BYTES = 256 * 1024;
+
+	// Copies the arena into fresh huge-page-aligned storage, which is advised before the copy first touches it
+	// Returns the bytes moved, 0 if the arena was left as is
+	template <typename T>
+	size_t MoveToHugePages(Native::AlignedVec<T>& arena) {
+		size_t bytes = arena.size() * sizeof(T);
+		if (bytes < MIN_HUGE_PAGE_ARENA_BYTES)
+			return 0;
+
+		Native::AlignedVec<T> moved{ Native::AlignedAllocator<T>(HUGE_PAGE_SIZE) };
+		moved.reserve(arena.size()); // Rounded up to whole huge pages by the allocator
+		size_t reservedBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		if (AdviseHugePageMemory(moved.data(), reservedBytes) == 0)
+			return 0;
+
+		moved.assign(arena.begin(), arena.end());
+		arena.swap(moved);
+		return bytes;
+	}
+}
+
+GGL::NativeInferenceBackend::NativeInferenceBackend(ModelSet& models, int obsSize, int numActions, bool int8, bool bf16) :
+	InferenceBackend(obsSize, numActions), _rng(std::random_device{}()) {
+
+	// shared_head and policy end up in one plan
+	Native::Network network = {};
+	if (models["shared_head"])
+		network.AppendModel(*models["shared_head"]);
+	network.AppendModel(*models["policy"]);
+
+	if (network.numInputs != obsSize || network.numOutputs != numActions) {
+		RG_ERR_CLOSE(
+			"NativeInferenceBackend: Network maps " << network.numInputs << " -> " << network.numOutputs <<
+			", expected " << obsSize << " -> " << numActions
+		);
+	}
+
+	if (int8) {
+		// Not part of the weight regions, since it's only used for calibration and freed after it
+		_int8Reference = std::make_unique<Native::InferPlan>(Native::InferPlan::Compile(network, false));
+		quantPlan = std::make_unique<Native::QuantPlan>(Native::QuantPlan::Compile(network));
+		RG_LOG(
+			"NativeInferenceBackend: Using " << Native::GetKernelISAName(Native::GetKernelISA()) << " kernels, " <<
+			quantPlan->ops.size() << " INT8 ops, " << (quantPlan->weights.size() / 1024) << "KB of weights"
+		);
+	} else {
+		plan = Native::InferPlan::Compile(network, bf16);
+		if (plan.bf16)
+			precision = InferPrecision::BF16;
+
+		RG_LOG(
+			"NativeInferenceBackend: Using " << Native::GetKernelISAName(Native::GetKernelISA()) << " kernels, " <<
+			plan.ops.size() << (plan.bf16 ? " fused bf16 ops, " : " fused ops, ") << (plan.GetWeightBytes() / 1024) << "KB of weights"
+		);
+	}
+
+	EnsureScratch(1);
+}
+
+void GGL::NativeInferenceBackend::EnsureScratch(int batchSize) {
+	if (batchSize <= _scratchRows)
+		return;
+
+	_scratch.resize(quantPlan ? quantPlan->GetScratchSize(batchSize) : plan.GetScratchSize(batchSize));
+	_scratchRows = batchSize;
+}
+
+const float* GGL::NativeInferenceBackend::Forward(const float* obs, int batchSize, int& outStride, const uint8_t* actionMasks) {
+	EnsureScratch(batchSize);
+
+	if (quantPlan) {
+		if (actionMasks && sparseOutput && !_loggedSparseIgnored) {
+			RG_LOG("NativeInferenceBackend: Sparse output isn't supported by INT8 plans, all logits are computed");
+			_loggedSparseIgnored = true;
+		}
+
+		outStride = quantPlan->GetOutputStride();
+		return quantPlan->Forward(obs, batchSize, _scratch.data());
+	} else {
+		outStride = plan.GetOutputStride();
+		if (actionMasks && sparseOutput && plan.hasSparseOutput)
+			return plan.ForwardSparse(obs, batchSize, actionMasks, _scratch.data());
+		return plan.Forward(obs, batchSize, _scratch.data());
+	}
+}
+
+GGL::Native::QuantReport GGL::NativeInferenceBackend::CalibrateInt8(const float* obs, const uint8_t* actionMasks, int numSamples, bool setScales) {
+	RG_ASSERT(quantPlan);
+	if (!_int8Reference)
+		RG_ERR_CLOSE("NativeInferenceBackend::CalibrateInt8(): The fp32 reference plan was already freed");
+
+	if (setScales)
+		quantPlan->Calibrate(obs, numSamples);
+
+	return Native::CompareQuantPlan(*_int8Reference, *quantPlan, obs, actionMasks, numSamples);
+}
+
+std::vector<GGL::MemoryRegion> GGL::NativeInferenceBackend::GetWeightRegions() const {
+	std::vector<MemoryRegion> regions;
+
+	if (quantPlan) {
+		regions.push_back({ quantPlan->weights.data(), quantPlan->weights.size() });
+		regions.push_back({ quantPlan->weightSums.data(), quantPlan->weightSums.size() * sizeof(int32_t) });
+		regions.push_back({ quantPlan->params.data(), quantPlan->params.size() * sizeof(float) });
+	} else {
+		regions.push_back({ plan.arena.data(), plan.arena.size() * sizeof(float) });
+		regions.push_back({ plan.bf16Weights.data(), plan.bf16Weights.size() * sizeof(uint16_t) });
+	}
+	return regions;
+}
+
+size_t GGL::NativeInferenceBackend::MoveWeightsToHugePages() {
+	if (quantPlan)
+		return MoveToHugePages(quantPlan->weights);
+
+	return MoveToHugePages(plan.arena) + MoveToHugePages(plan.bf16Weights);
+}
+
+void GGL::NativeInferenceBackend::InferLogits(const float* obs, int batchSize, float* outLogits) {
+	int stride;
+	const float* logits = Forward(obs, batchSize, stride);
+	for (int i = 0; i < batchSize; i++)
+		memcpy(outLogits + (size_t)i * numActions, logits + (size_t)i * stride, numActions * sizeof(float));
+}
+
+void GGL::NativeInferenceBackend::InferActions(
+	const float* obs, const uint8_t* actionMasks, int batchSize,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	int stride;
+	const float* allLogits = Forward(obs, batchSize, stride, actionMasks);
+	SelectMaskedActions(allLogits, stride, actionMasks, batchSize, numActions, deterministic, temperature, outActions, outLogProbs, rngs, _rng);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "InferenceBackend.h"
+#include "QuantPlan.h"
+
+namespace GGL {
+
+	class NativeInferenceBackend : public InferenceBackend {
+	public:
+		Native::InferPlan plan; // Empty with INT8
+		std::unique_ptr<Native::QuantPlan> quantPlan; // Only with INT8
+
+		// Only evaluate the output rows of enabled actions when selecting actions (fp32/bf16 plans only, ignored with INT8)
+		bool sparseOutput = true;
+
+		// bf16 is ignored with int8, where an fp32 plan is built as the calibration reference (see FreeInt8Reference())
+		NativeInferenceBackend(ModelSet& models, int obsSize, int numActions, bool int8, bool bf16 = false);
+
+		virtual const char* GetName() const override { return quantPlan ? "native-int8" : "native"; }
+
+		// Calibrates INT8 activation scales on recorded observations (if setScales), then reports agreement with fp32 on them
+		Native::QuantReport CalibrateInt8(const float* obs, const uint8_t* actionMasks, int numSamples, bool setScales);
+
+		// Frees the fp32 reference plan, so only the INT8 weights stay in memory
+		// CalibrateInt8() can't be called afterwards
+		void FreeInt8Reference() { _int8Reference.reset(); }
+
+		virtual std::vector<MemoryRegion> GetWeightRegions() const override;
+		virtual size_t MoveWeightsToHugePages() override;
+
+		virtual void InferLogits(const float* obs, int batchSize, float* outLogits) override;
+
+		virtual void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) override;
+
+	private:
+		Native::AlignedVec<float> _scratch;
+		int _scratchRows = 0;
+		FastRNG _rng;
+
+		std::unique_ptr<Native::InferPlan> _int8Reference; // fp32 plan CalibrateInt8() compares against
+		bool _loggedSparseIgnored = false;
+
+		void EnsureScratch(int batchSize);
+
+		// Runs whichever plan is active, returns the logits and their row stride
+		// If actionMasks is set, disabled logits may be skipped (see sparseOutput)
+		const float* Forward(const float* obs, int batchSize, int& outStride, const uint8_t* actionMasks = NULL);
+	};
+}
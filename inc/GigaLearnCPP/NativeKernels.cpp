@@ -0,0 +1,978 @@
+#include "NativeKernels.h"
+
+#ifdef GGL_NATIVE_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+using namespace GGL;
+
+namespace {
+
+#ifdef GGL_NATIVE_X86
+	void CPUID(uint32_t leaf, uint32_t subleaf, uint32_t out[4]) {
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuidex(regs, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; i++)
+			out[i] = (uint32_t)regs[i];
+#else
+		__cpuid_count(leaf, subleaf, out[0], out[1], out[2], out[3]);
+#endif
+	}
+
+	uint64_t XGETBV(uint32_t idx) {
+#if defined(_MSC_VER)
+		return _xgetbv(idx);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(idx));
+		return ((uint64_t)edx << 32) | eax;
+#endif
+	}
+#endif
+
+	Native::CPUFeatures DetectCPUFeatures() {
+		Native::CPUFeatures result = {};
+
+#ifdef GGL_NATIVE_X86
+		uint32_t regs[4];
+		CPUID(0, 0, regs);
+		uint32_t maxLeaf = regs[0];
+		if (maxLeaf < 7)
+			return result;
+
+		CPUID(1, 0, regs);
+		bool osxsave = (regs[2] >> 27) & 1;
+		bool avx = (regs[2] >> 28) & 1;
+		bool fma = (regs[2] >> 12) & 1;
+		if (!osxsave || !avx)
+			return result;
+
+		uint64_t xcr0 = XGETBV(0);
+		bool osAVX = (xcr0 & 0x6) == 0x6;
+		bool osAVX512 = osAVX && (xcr0 & 0xE0) == 0xE0;
+		bool osAMX = (xcr0 & 0x60000) == 0x60000;
+		if (!osAVX)
+			return result;
+
+		CPUID(7, 0, regs);
+		uint32_t maxSubleaf = regs[0];
+		result.avx2 = (regs[1] >> 5) & 1;
+		result.fma = fma;
+		result.avx512f = osAVX512 && ((regs[1] >> 16) & 1);
+		result.avx512bw = osAVX512 && ((regs[1] >> 30) & 1);
+		result.avx512vnni = result.avx512bw && ((regs[2] >> 11) & 1);
+		result.amxBF16 = osAMX && ((regs[3] >> 22) & 1) && ((regs[3] >> 24) & 1);
+
+		if (maxSubleaf >= 1) {
+			CPUID(7, 1, regs);
+			result.avx512bf16 = result.avx512f && ((regs[0] >> 5) & 1);
+		}
+#endif
+
+		return result;
+	}
+
+	Native::KernelISA DetectBestISA() {
+		auto& features = Native::GetCPUFeatures();
+		if (features.avx512f)
+			return Native::KernelISA::AVX512;
+		if (features.avx2 && features.fma)
+			return Native::KernelISA::AVX2;
+		return Native::KernelISA::SCALAR;
+	}
+
+	Native::KernelISA g_ISA = DetectBestISA();
+
+	//////////////////// Scalar ////////////////////
+
+	// The Linear kernels evaluate rows[0..outSize) if rows is set, otherwise every row
+	inline int RowAt(const int* rows, int i) {
+		return rows ? rows[i] : i;
+	}
+
+	void Linear_Scalar(const float* in, const float* weight, const float* bias, float* out, int inSize, int outSize, const int* rows) {
+		for (int j = 0; j < outSize; j++) {
+			int o = RowAt(rows, j);
+			const float* w = weight + (size_t)o * inSize;
+			float sum = 0;
+			for (int i = 0; i < inSize; i++)
+				sum += w[i] * in[i];
+			out[o] = bias ? (sum + bias[o]) : sum;
+		}
+	}
+
+	void LayerNorm_Scalar(float* data, const float* gamma, const float* beta, int size, float eps, bool fuseReLU, float negativeSlope) {
+		float mean = 0;
+		for (int i = 0; i < size; i++)
+			mean += data[i];
+		mean /= size;
+
+		float var = 0;
+		for (int i = 0; i < size; i++) {
+			float d = data[i] - mean;
+			var += d * d;
+		}
+		var /= size;
+
+		float invStd = 1 / sqrtf(var + eps);
+		for (int i = 0; i < size; i++) {
+			float x = (data[i] - mean) * invStd * gamma[i] + beta[i];
+			data[i] = (fuseReLU && x < 0) ? x * negativeSlope : x;
+		}
+	}
+
+	void PanelLinear_Scalar(
+		const float* in, int inStride, float* out, int outStride, int numRows,
+		const float* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU, float negativeSlope) {
+
+		constexpr int P = Native::PANEL_WIDTH;
+		for (int p = 0; p < paddedOutSize; p += P) {
+			const float* panel = panels + (size_t)p * inSize;
+			for (int r = 0; r < numRows; r++) {
+				const float* x = in + (size_t)r * inStride;
+
+				float acc[P];
+				for (int j = 0; j < P; j++)
+					acc[j] = bias[p + j];
+
+				for (int k = 0; k < inSize; k++) {
+					const float* w = panel + (size_t)k * P;
+					for (int j = 0; j < P; j++)
+						acc[j] += x[k] * w[j];
+				}
+
+				float* o = out + (size_t)r * outStride + p;
+				for (int j = 0; j < P; j++)
+					o[j] = (fuseReLU && acc[j] < 0) ? acc[j] * negativeSlope : acc[j];
+			}
+		}
+	}
+
+	void BF16PanelLinear_Scalar(
+		const uint16_t* in, int inStride, float* out, int outStride, int numRows,
+		const uint16_t* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU, float negativeSlope) {
+
+		constexpr int P = Native::PANEL_WIDTH;
+		int paddedInSize = Native::GetBF16PaddedSize(inSize);
+		for (int p = 0; p < paddedOutSize; p += P) {
+			const uint16_t* panel = panels + (size_t)p * paddedInSize;
+			for (int r = 0; r < numRows; r++) {
+				const uint16_t* x = in + (size_t)r * inStride;
+
+				float acc[P];
+				for (int j = 0; j < P; j++)
+					acc[j] = bias[p + j];
+
+				for (int k = 0; k < paddedInSize; k += 2) {
+					const uint16_t* w = panel + (size_t)k * P;
+					float x0 = Native::BF16ToFloat(x[k]), x1 = Native::BF16ToFloat(x[k + 1]);
+					for (int j = 0; j < P; j++)
+						acc[j] += x0 * Native::BF16ToFloat(w[j * 2]) + x1 * Native::BF16ToFloat(w[j * 2 + 1]);
+				}
+
+				float* o = out + (size_t)r * outStride + p;
+				for (int j = 0; j < P; j++)
+					o[j] = (fuseReLU && acc[j] < 0) ? acc[j] * negativeSlope : acc[j];
+			}
+		}
+	}
+
+	void Int8Linear_Scalar(
+		const int8_t* in, const int8_t* panels, const int32_t* weightSums, const float* weightScales, float inScale,
+		const float* bias, float* out, int paddedInSize, int paddedOutSize) {
+
+		constexpr int P = Native::INT8_PANEL_WIDTH, K = Native::INT8_K_GROUP;
+		for (int o = 0; o < paddedOutSize; o++) {
+			const int8_t* panel = panels + (size_t)(o / P) * P * paddedInSize;
+			int j = o % P;
+
+			int32_t dot = 0;
+			for (int i = 0; i < paddedInSize; i++)
+				dot += (int32_t)in[i] * panel[(i / K) * P * K + j * K + (i % K)];
+
+			out[o] = dot * inScale * weightScales[o] + bias[o];
+		}
+	}
+
+	float AbsMax_Scalar(const float* data, int size, float result = 0, int start = 0) {
+		for (int i = start; i < size; i++)
+			result = RS_MAX(result, fabsf(data[i]));
+		return result;
+	}
+
+	// Rounds half to even, same as the SIMD conversions
+	void QuantizeRow_Scalar(const float* in, int size, float invScale, int8_t* out, int start = 0) {
+		for (int i = start; i < size; i++) {
+			float q = nearbyintf(in[i] * invScale);
+			out[i] = (int8_t)RS_MIN(RS_MAX(q, -127.f), 127.f);
+		}
+	}
+
+	void Activation_Scalar(float* data, int size, ModelActivationType type, float negativeSlope, int start = 0) {
+		switch (type) {
+		case ModelActivationType::RELU:
+			for (int i = start; i < size; i++)
+				data[i] = data[i] > 0 ? data[i] : 0;
+			return;
+		case ModelActivationType::LEAKY_RELU:
+			for (int i = start; i < size; i++)
+				data[i] = data[i] > 0 ? data[i] : data[i] * negativeSlope;
+			return;
+		case ModelActivationType::SIGMOID:
+			for (int i = start; i < size; i++)
+				data[i] = 1 / (1 + expf(-data[i]));
+			return;
+		case ModelActivationType::TANH:
+			for (int i = start; i < size; i++)
+				data[i] = tanhf(data[i]);
+			return;
+		}
+	}
+
+#ifdef GGL_NATIVE_X86
+	//////////////////// AVX2 ////////////////////
+
+	GGL_TARGET_AVX2 inline float HSum256(__m256 v) {
+		__m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+		lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+		return _mm_cvtss_f32(lo);
+	}
+
+	GGL_TARGET_AVX2 void Linear_AVX2(const float* in, const float* weight, const float* bias, float* out, int inSize, int outSize, const int* rows) {
+		int vecEnd = inSize & ~7;
+
+		// 4 rows at a time so each loaded input vector is reused 4 times
+		int j = 0;
+		for (; j + 4 <= outSize; j += 4) {
+			int o0 = RowAt(rows, j), o1 = RowAt(rows, j + 1), o2 = RowAt(rows, j + 2), o3 = RowAt(rows, j + 3);
+			const float* w0 = weight + (size_t)o0 * inSize;
+			const float* w1 = weight + (size_t)o1 * inSize;
+			const float* w2 = weight + (size_t)o2 * inSize;
+			const float* w3 = weight + (size_t)o3 * inSize;
+
+			__m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps(), a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+			for (int i = 0; i < vecEnd; i += 8) {
+				__m256 x = _mm256_loadu_ps(in + i);
+				a0 = _mm256_fmadd_ps(_mm256_loadu_ps(w0 + i), x, a0);
+				a1 = _mm256_fmadd_ps(_mm256_loadu_ps(w1 + i), x, a1);
+				a2 = _mm256_fmadd_ps(_mm256_loadu_ps(w2 + i), x, a2);
+				a3 = _mm256_fmadd_ps(_mm256_loadu_ps(w3 + i), x, a3);
+			}
+
+			float s0 = HSum256(a0), s1 = HSum256(a1), s2 = HSum256(a2), s3 = HSum256(a3);
+			for (int i = vecEnd; i < inSize; i++) {
+				s0 += w0[i] * in[i];
+				s1 += w1[i] * in[i];
+				s2 += w2[i] * in[i];
+				s3 += w3[i] * in[i];
+			}
+
+			if (bias) {
+				s0 += bias[o0];
+				s1 += bias[o1];
+				s2 += bias[o2];
+				s3 += bias[o3];
+			}
+
+			out[o0] = s0;
+			out[o1] = s1;
+			out[o2] = s2;
+			out[o3] = s3;
+		}
+
+		for (; j < outSize; j++) {
+			int o = RowAt(rows, j);
+			const float* w = weight + (size_t)o * inSize;
+			__m256 acc = _mm256_setzero_ps();
+			for (int i = 0; i < vecEnd; i += 8)
+				acc = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_loadu_ps(in + i), acc);
+
+			float sum = HSum256(acc);
+			for (int i = vecEnd; i < inSize; i++)
+				sum += w[i] * in[i];
+			out[o] = bias ? (sum + bias[o]) : sum;
+		}
+	}
+
+	GGL_TARGET_AVX2 void LayerNorm_AVX2(float* data, const float* gamma, const float* beta, int size, float eps, bool fuseReLU, float negativeSlope) {
+		int vecEnd = size & ~7;
+
+		__m256 acc = _mm256_setzero_ps();
+		for (int i = 0; i < vecEnd; i += 8)
+			acc = _mm256_add_ps(acc, _mm256_loadu_ps(data + i));
+		float mean = HSum256(acc);
+		for (int i = vecEnd; i < size; i++)
+			mean += data[i];
+		mean /= size;
+
+		__m256 meanVec = _mm256_set1_ps(mean);
+		acc = _mm256_setzero_ps();
+		for (int i = 0; i < vecEnd; i += 8) {
+			__m256 d = _mm256_sub_ps(_mm256_loadu_ps(data + i), meanVec);
+			acc = _mm256_fmadd_ps(d, d, acc);
+		}
+		float var = HSum256(acc);
+		for (int i = vecEnd; i < size; i++) {
+			float d = data[i] - mean;
+			var += d * d;
+		}
+		var /= size;
+
+		float invStd = 1 / sqrtf(var + eps);
+		__m256 invStdVec = _mm256_set1_ps(invStd);
+		__m256 slopeVec = _mm256_set1_ps(negativeSlope);
+		for (int i = 0; i < vecEnd; i += 8) {
+			__m256 d = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(data + i), meanVec), invStdVec);
+			d = _mm256_fmadd_ps(d, _mm256_loadu_ps(gamma + i), _mm256_loadu_ps(beta + i));
+			if (fuseReLU)
+				d = _mm256_max_ps(d, _mm256_mul_ps(d, slopeVec));
+			_mm256_storeu_ps(data + i, d);
+		}
+		for (int i = vecEnd; i < size; i++) {
+			float x = (data[i] - mean) * invStd * gamma[i] + beta[i];
+			data[i] = (fuseReLU && x < 0) ? x * negativeSlope : x;
+		}
+	}
+
+	GGL_TARGET_AVX2 void PanelLinear_AVX2(
+		const float* in, int inStride, float* out, int outStride, int numRows,
+		const float* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU, float negativeSlope) {
+
+		static_assert(Native::PANEL_WIDTH == 32, "PanelLinear_AVX2 assumes 4 vectors per panel");
+		constexpr int P = Native::PANEL_WIDTH;
+		__m256 slopeVec = _mm256_set1_ps(negativeSlope);
+
+		for (int p = 0; p < paddedOutSize; p += P) {
+			const float* panel = panels + (size_t)p * inSize;
+			for (int r = 0; r < numRows; r++) {
+				const float* x = in + (size_t)r * inStride;
+
+				// Two sets of accumulators (even/odd inputs) to hide FMA latency
+				__m256 a0 = _mm256_loadu_ps(bias + p + 0), a1 = _mm256_loadu_ps(bias + p + 8);
+				__m256 a2 = _mm256_loadu_ps(bias + p + 16), a3 = _mm256_loadu_ps(bias + p + 24);
+				__m256 b0 = _mm256_setzero_ps(), b1 = _mm256_setzero_ps(), b2 = _mm256_setzero_ps(), b3 = _mm256_setzero_ps();
+
+				int k = 0;
+				for (; k + 2 <= inSize; k += 2) {
+					const float* w = panel + (size_t)k * P;
+					__m256 x0 = _mm256_broadcast_ss(x + k), x1 = _mm256_broadcast_ss(x + k + 1);
+					a0 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 0), x0, a0);
+					a1 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 8), x0, a1);
+					a2 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 16), x0, a2);
+					a3 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 24), x0, a3);
+					b0 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 32), x1, b0);
+					b1 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 40), x1, b1);
+					b2 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 48), x1, b2);
+					b3 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 56), x1, b3);
+				}
+				if (k < inSize) {
+					const float* w = panel + (size_t)k * P;
+					__m256 x0 = _mm256_broadcast_ss(x + k);
+					a0 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 0), x0, a0);
+					a1 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 8), x0, a1);
+					a2 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 16), x0, a2);
+					a3 = _mm256_fmadd_ps(_mm256_loadu_ps(w + 24), x0, a3);
+				}
+
+				a0 = _mm256_add_ps(a0, b0);
+				a1 = _mm256_add_ps(a1, b1);
+				a2 = _mm256_add_ps(a2, b2);
+				a3 = _mm256_add_ps(a3, b3);
+
+				if (fuseReLU) {
+					a0 = _mm256_max_ps(a0, _mm256_mul_ps(a0, slopeVec));
+					a1 = _mm256_max_ps(a1, _mm256_mul_ps(a1, slopeVec));
+					a2 = _mm256_max_ps(a2, _mm256_mul_ps(a2, slopeVec));
+					a3 = _mm256_max_ps(a3, _mm256_mul_ps(a3, slopeVec));
+				}
+
+				float* o = out + (size_t)r * outStride + p;
+				_mm256_storeu_ps(o + 0, a0);
+				_mm256_storeu_ps(o + 8, a1);
+				_mm256_storeu_ps(o + 16, a2);
+				_mm256_storeu_ps(o + 24, a3);
+			}
+		}
+	}
+
+	GGL_TARGET_AVX2 void Activation_AVX2(float* data, int size, ModelActivationType type, float negativeSlope) {
+		int vecEnd = size & ~7;
+
+		if (type == ModelActivationType::RELU) {
+			__m256 zero = _mm256_setzero_ps();
+			for (int i = 0; i < vecEnd; i += 8)
+				_mm256_storeu_ps(data + i, _mm256_max_ps(_mm256_loadu_ps(data + i), zero));
+		} else if (type == ModelActivationType::LEAKY_RELU && negativeSlope <= 1) {
+			__m256 slope = _mm256_set1_ps(negativeSlope);
+			for (int i = 0; i < vecEnd; i += 8) {
+				__m256 x = _mm256_loadu_ps(data + i);
+				_mm256_storeu_ps(data + i, _mm256_max_ps(x, _mm256_mul_ps(x, slope)));
+			}
+		} else {
+			vecEnd = 0;
+		}
+
+		Activation_Scalar(data, size, type, negativeSlope, vecEnd);
+	}
+
+	GGL_TARGET_AVX2 float AbsMax_AVX2(const float* data, int size) {
+		int vecEnd = size & ~7;
+		__m256 signMask = _mm256_set1_ps(-0.f);
+		__m256 acc = _mm256_setzero_ps();
+		for (int i = 0; i < vecEnd; i += 8)
+			acc = _mm256_max_ps(acc, _mm256_andnot_ps(signMask, _mm256_loadu_ps(data + i)));
+
+		__m128 m = _mm_max_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+		m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+		m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+		return AbsMax_Scalar(data, size, _mm_cvtss_f32(m), vecEnd);
+	}
+
+	GGL_TARGET_AVX2 void QuantizeRow_AVX2(const float* in, int size, float invScale, int8_t* out) {
+		int vecEnd = size & ~15;
+		__m256 mul = _mm256_set1_ps(invScale);
+		__m256 lo = _mm256_set1_ps(-127.f), hi = _mm256_set1_ps(127.f);
+		for (int i = 0; i < vecEnd; i += 16) {
+			__m256i q0 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), mul), lo), hi));
+			__m256i q1 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), mul), lo), hi));
+			__m256i q16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(q0, q1), 0xD8);
+			__m128i q8 = _mm_packs_epi16(_mm256_castsi256_si128(q16), _mm256_extracti128_si256(q16, 1));
+			_mm_storeu_si128((__m128i*)(out + i), q8);
+		}
+
+		QuantizeRow_Scalar(in, size, invScale, out, vecEnd);
+	}
+
+	inline int32_t LoadInt32(const int8_t* ptr) {
+		int32_t result;
+		memcpy(&result, ptr, sizeof(result));
+		return result;
+	}
+
+	GGL_TARGET_AVX2 void Int8Linear_AVX2(
+		const int8_t* in, const int8_t* panels, const int32_t* weightSums, const float* weightScales, float inScale,
+		const float* bias, float* out, int paddedInSize, int paddedOutSize) {
+
+		static_assert(Native::INT8_PANEL_WIDTH == 16 && Native::INT8_K_GROUP == 4, "Int8Linear_AVX2 assumes 16x4 panels");
+
+		// Each 16-byte slice of a panel group is 4 outputs x 4 inputs
+		// Sign-extend to int16 and madd against the 4 broadcast inputs, giving 2 partial sums per output
+		__m256 scale = _mm256_set1_ps(inScale);
+		int numGroups = paddedInSize / Native::INT8_K_GROUP;
+
+		for (int o = 0; o < paddedOutSize; o += 16) {
+			const int8_t* panel = panels + (size_t)o * paddedInSize;
+
+			__m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256(), a2 = _mm256_setzero_si256(), a3 = _mm256_setzero_si256();
+			for (int g = 0; g < numGroups; g++) {
+				__m256i x = _mm256_broadcastq_epi64(_mm_cvtepi8_epi16(_mm_cvtsi32_si128(LoadInt32(in + g * 4))));
+				const int8_t* w = panel + g * 64;
+				a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + 0))), x));
+				a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + 16))), x));
+				a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + 32))), x));
+				a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + 48))), x));
+			}
+
+			// hadd gives [0 1 4 5 | 2 3 6 7], the permute puts the outputs back in order
+			__m256i lo = _mm256_permute4x64_epi64(_mm256_hadd_epi32(a0, a1), 0xD8);
+			__m256i hi = _mm256_permute4x64_epi64(_mm256_hadd_epi32(a2, a3), 0xD8);
+
+			__m256 scaleLo = _mm256_mul_ps(scale, _mm256_loadu_ps(weightScales + o));
+			__m256 scaleHi = _mm256_mul_ps(scale, _mm256_loadu_ps(weightScales + o + 8));
+			_mm256_storeu_ps(out + o, _mm256_fmadd_ps(_mm256_cvtepi32_ps(lo), scaleLo, _mm256_loadu_ps(bias + o)));
+			_mm256_storeu_ps(out + o + 8, _mm256_fmadd_ps(_mm256_cvtepi32_ps(hi), scaleHi, _mm256_loadu_ps(bias + o + 8)));
+		}
+	}
+
+	//////////////////// AVX-512 ////////////////////
+
+	GGL_TARGET_AVX512 void Linear_AVX512(const float* in, const float* weight, const float* bias, float* out, int inSize, int outSize, const int* rows) {
+		int vecEnd = inSize & ~15;
+		__mmask16 tailMask = (__mmask16)((1u << (inSize - vecEnd)) - 1);
+
+		int j = 0;
+		for (; j + 4 <= outSize; j += 4) {
+			int o0 = RowAt(rows, j), o1 = RowAt(rows, j + 1), o2 = RowAt(rows, j + 2), o3 = RowAt(rows, j + 3);
+			const float* w0 = weight + (size_t)o0 * inSize;
+			const float* w1 = weight + (size_t)o1 * inSize;
+			const float* w2 = weight + (size_t)o2 * inSize;
+			const float* w3 = weight + (size_t)o3 * inSize;
+
+			__m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+			for (int i = 0; i < vecEnd; i += 16) {
+				__m512 x = _mm512_loadu_ps(in + i);
+				a0 = _mm512_fmadd_ps(_mm512_loadu_ps(w0 + i), x, a0);
+				a1 = _mm512_fmadd_ps(_mm512_loadu_ps(w1 + i), x, a1);
+				a2 = _mm512_fmadd_ps(_mm512_loadu_ps(w2 + i), x, a2);
+				a3 = _mm512_fmadd_ps(_mm512_loadu_ps(w3 + i), x, a3);
+			}
+
+			if (tailMask) {
+				__m512 x = _mm512_maskz_loadu_ps(tailMask, in + vecEnd);
+				a0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, w0 + vecEnd), x, a0);
+				a1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, w1 + vecEnd), x, a1);
+				a2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, w2 + vecEnd), x, a2);
+				a3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, w3 + vecEnd), x, a3);
+			}
+
+			out[o0] = _mm512_reduce_add_ps(a0) + (bias ? bias[o0] : 0);
+			out[o1] = _mm512_reduce_add_ps(a1) + (bias ? bias[o1] : 0);
+			out[o2] = _mm512_reduce_add_ps(a2) + (bias ? bias[o2] : 0);
+			out[o3] = _mm512_reduce_add_ps(a3) + (bias ? bias[o3] : 0);
+		}
+
+		for (; j < outSize; j++) {
+			int o = RowAt(rows, j);
+			const float* w = weight + (size_t)o * inSize;
+			__m512 acc = _mm512_setzero_ps();
+			for (int i = 0; i < vecEnd; i += 16)
+				acc = _mm512_fmadd_ps(_mm512_loadu_ps(w + i), _mm512_loadu_ps(in + i), acc);
+			if (tailMask)
+				acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, w + vecEnd), _mm512_maskz_loadu_ps(tailMask, in + vecEnd), acc);
+			out[o] = _mm512_reduce_add_ps(acc) + (bias ? bias[o] : 0);
+		}
+	}
+
+	GGL_TARGET_AVX512 void LayerNorm_AVX512(float* data, const float* gamma, const float* beta, int size, float eps, bool fuseReLU, float negativeSlope) {
+		int vecEnd = size & ~15;
+		__mmask16 tailMask = (__mmask16)((1u << (size - vecEnd)) - 1);
+
+		__m512 acc = _mm512_maskz_loadu_ps(tailMask, data + vecEnd);
+		for (int i = 0; i < vecEnd; i += 16)
+			acc = _mm512_add_ps(acc, _mm512_loadu_ps(data + i));
+		float mean = _mm512_reduce_add_ps(acc) / size;
+
+		__m512 meanVec = _mm512_set1_ps(mean);
+		acc = _mm512_setzero_ps();
+		for (int i = 0; i < vecEnd; i += 16) {
+			__m512 d = _mm512_sub_ps(_mm512_loadu_ps(data + i), meanVec);
+			acc = _mm512_fmadd_ps(d, d, acc);
+		}
+		if (tailMask) {
+			__m512 d = _mm512_maskz_sub_ps(tailMask, _mm512_maskz_loadu_ps(tailMask, data + vecEnd), meanVec);
+			acc = _mm512_fmadd_ps(d, d, acc);
+		}
+		float var = _mm512_reduce_add_ps(acc) / size;
+
+		__m512 invStdVec = _mm512_set1_ps(1 / sqrtf(var + eps));
+		__m512 slopeVec = _mm512_set1_ps(negativeSlope);
+		for (int i = 0; i < vecEnd; i += 16) {
+			__m512 d = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(data + i), meanVec), invStdVec);
+			d = _mm512_fmadd_ps(d, _mm512_loadu_ps(gamma + i), _mm512_loadu_ps(beta + i));
+			if (fuseReLU)
+				d = _mm512_max_ps(d, _mm512_mul_ps(d, slopeVec));
+			_mm512_storeu_ps(data + i, d);
+		}
+		if (tailMask) {
+			__m512 d = _mm512_mul_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(tailMask, data + vecEnd), meanVec), invStdVec);
+			d = _mm512_fmadd_ps(d, _mm512_maskz_loadu_ps(tailMask, gamma + vecEnd), _mm512_maskz_loadu_ps(tailMask, beta + vecEnd));
+			if (fuseReLU)
+				d = _mm512_max_ps(d, _mm512_mul_ps(d, slopeVec));
+			_mm512_mask_storeu_ps(data + vecEnd, tailMask, d);
+		}
+	}
+
+	GGL_TARGET_AVX512 void PanelLinear_AVX512(
+		const float* in, int inStride, float* out, int outStride, int numRows,
+		const float* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU, float negativeSlope) {
+
+		static_assert(Native::PANEL_WIDTH == 32, "PanelLinear_AVX512 assumes 2 vectors per panel");
+		constexpr int P = Native::PANEL_WIDTH;
+		__m512 slopeVec = _mm512_set1_ps(negativeSlope);
+
+		for (int p = 0; p < paddedOutSize; p += P) {
+			const float* panel = panels + (size_t)p * inSize;
+			for (int r = 0; r < numRows; r++) {
+				const float* x = in + (size_t)r * inStride;
+
+				// Four sets of accumulators (inputs mod 4) to hide FMA latency
+				__m512 a0 = _mm512_loadu_ps(bias + p), a1 = _mm512_loadu_ps(bias + p + 16);
+				__m512 b0 = _mm512_setzero_ps(), b1 = _mm512_setzero_ps();
+				__m512 c0 = _mm512_setzero_ps(), c1 = _mm512_setzero_ps();
+				__m512 d0 = _mm512_setzero_ps(), d1 = _mm512_setzero_ps();
+
+				int k = 0;
+				for (; k + 4 <= inSize; k += 4) {
+					const float* w = panel + (size_t)k * P;
+					__m512 x0 = _mm512_set1_ps(x[k]), x1 = _mm512_set1_ps(x[k + 1]);
+					__m512 x2 = _mm512_set1_ps(x[k + 2]), x3 = _mm512_set1_ps(x[k + 3]);
+					a0 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 0), x0, a0);
+					a1 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 16), x0, a1);
+					b0 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 32), x1, b0);
+					b1 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 48), x1, b1);
+					c0 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 64), x2, c0);
+					c1 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 80), x2, c1);
+					d0 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 96), x3, d0);
+					d1 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 112), x3, d1);
+				}
+				for (; k < inSize; k++) {
+					const float* w = panel + (size_t)k * P;
+					__m512 x0 = _mm512_set1_ps(x[k]);
+					a0 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 0), x0, a0);
+					a1 = _mm512_fmadd_ps(_mm512_loadu_ps(w + 16), x0, a1);
+				}
+
+				a0 = _mm512_add_ps(_mm512_add_ps(a0, b0), _mm512_add_ps(c0, d0));
+				a1 = _mm512_add_ps(_mm512_add_ps(a1, b1), _mm512_add_ps(c1, d1));
+
+				if (fuseReLU) {
+					a0 = _mm512_max_ps(a0, _mm512_mul_ps(a0, slopeVec));
+					a1 = _mm512_max_ps(a1, _mm512_mul_ps(a1, slopeVec));
+				}
+
+				float* o = out + (size_t)r * outStride + p;
+				_mm512_storeu_ps(o + 0, a0);
+				_mm512_storeu_ps(o + 16, a1);
+			}
+		}
+	}
+
+	GGL_TARGET_AVX512 void Activation_AVX512(float* data, int size, ModelActivationType type, float negativeSlope) {
+		int vecEnd = size & ~15;
+
+		if (type == ModelActivationType::RELU) {
+			__m512 zero = _mm512_setzero_ps();
+			for (int i = 0; i < vecEnd; i += 16)
+				_mm512_storeu_ps(data + i, _mm512_max_ps(_mm512_loadu_ps(data + i), zero));
+		} else if (type == ModelActivationType::LEAKY_RELU && negativeSlope <= 1) {
+			__m512 slope = _mm512_set1_ps(negativeSlope);
+			for (int i = 0; i < vecEnd; i += 16) {
+				__m512 x = _mm512_loadu_ps(data + i);
+				_mm512_storeu_ps(data + i, _mm512_max_ps(x, _mm512_mul_ps(x, slope)));
+			}
+		} else {
+			vecEnd = 0;
+		}
+
+		Activation_Scalar(data, size, type, negativeSlope, vecEnd);
+	}
+
+	GGL_TARGET_AVX512 float AbsMax_AVX512(const float* data, int size) {
+		int vecEnd = size & ~15;
+		__m512 acc = _mm512_setzero_ps();
+		for (int i = 0; i < vecEnd; i += 16)
+			acc = _mm512_max_ps(acc, _mm512_abs_ps(_mm512_loadu_ps(data + i)));
+		return AbsMax_Scalar(data, size, _mm512_reduce_max_ps(acc), vecEnd);
+	}
+
+	GGL_TARGET_AVX512 void QuantizeRow_AVX512(const float* in, int size, float invScale, int8_t* out) {
+		int vecEnd = size & ~15;
+		__m512 mul = _mm512_set1_ps(invScale);
+		__m512 lo = _mm512_set1_ps(-127.f), hi = _mm512_set1_ps(127.f);
+		for (int i = 0; i < vecEnd; i += 16) {
+			__m512i q = _mm512_cvtps_epi32(_mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(in + i), mul), lo), hi));
+			_mm_storeu_si128((__m128i*)(out + i), _mm512_cvtsepi32_epi8(q));
+		}
+
+		QuantizeRow_Scalar(in, size, invScale, out, vecEnd);
+	}
+
+	GGL_TARGET_AVX512VNNI void Int8Linear_AVX512VNNI(
+		const int8_t* in, const int8_t* panels, const int32_t* weightSums, const float* weightScales, float inScale,
+		const float* bias, float* out, int paddedInSize, int paddedOutSize) {
+
+		static_assert(Native::INT8_PANEL_WIDTH == 16 && Native::INT8_K_GROUP == 4, "Int8Linear_AVX512VNNI assumes 16x4 panels");
+
+		// dpbusd multiplies unsigned by signed bytes, so the input is shifted by 128 (a sign bit flip)
+		// and 128 * sum(weight row) is subtracted afterwards
+		const __m512i signFlip = _mm512_set1_epi32((int)0x80808080);
+		__m512 scale = _mm512_set1_ps(inScale);
+		int numGroups = paddedInSize / Native::INT8_K_GROUP;
+
+		for (int o = 0; o < paddedOutSize; o += 16) {
+			const int8_t* panel = panels + (size_t)o * paddedInSize;
+
+			// Independent accumulators to hide the dpbusd latency
+			__m512i a0 = _mm512_setzero_si512(), a1 = _mm512_setzero_si512(), a2 = _mm512_setzero_si512(), a3 = _mm512_setzero_si512();
+			int g = 0;
+			for (; g + 4 <= numGroups; g += 4) {
+				const int8_t* w = panel + g * 64;
+				a0 = _mm512_dpbusd_epi32(a0, _mm512_xor_si512(_mm512_set1_epi32(LoadInt32(in + g * 4 + 0)), signFlip), _mm512_loadu_si512(w + 0));
+				a1 = _mm512_dpbusd_epi32(a1, _mm512_xor_si512(_mm512_set1_epi32(LoadInt32(in + g * 4 + 4)), signFlip), _mm512_loadu_si512(w + 64));
+				a2 = _mm512_dpbusd_epi32(a2, _mm512_xor_si512(_mm512_set1_epi32(LoadInt32(in + g * 4 + 8)), signFlip), _mm512_loadu_si512(w + 128));
+				a3 = _mm512_dpbusd_epi32(a3, _mm512_xor_si512(_mm512_set1_epi32(LoadInt32(in + g * 4 + 12)), signFlip), _mm512_loadu_si512(w + 192));
+			}
+			for (; g < numGroups; g++)
+				a0 = _mm512_dpbusd_epi32(a0, _mm512_xor_si512(_mm512_set1_epi32(LoadInt32(in + g * 4)), signFlip), _mm512_loadu_si512(panel + g * 64));
+
+			__m512i dot = _mm512_add_epi32(_mm512_add_epi32(a0, a1), _mm512_add_epi32(a2, a3));
+			dot = _mm512_sub_epi32(dot, _mm512_slli_epi32(_mm512_loadu_si512(weightSums + o), 7));
+
+			__m512 rowScale = _mm512_mul_ps(scale, _mm512_loadu_ps(weightScales + o));
+			_mm512_storeu_ps(out + o, _mm512_fmadd_ps(_mm512_cvtepi32_ps(dot), rowScale, _mm512_loadu_ps(bias + o)));
+		}
+	}
+
+	// __m512bh is its own vector type on GCC/Clang, but just __m512i on MSVC
+	template <typename T>
+	GGL_TARGET_AVX512BF16 inline __m512bh AsBF16Vec(T v) {
+		return (__m512bh)v;
+	}
+
+	GGL_TARGET_AVX512BF16 void ConvertToBF16_AVX512BF16(const float* in, int size, uint16_t* out) {
+		int vecEnd = size & ~15;
+		for (int i = 0; i < vecEnd; i += 16)
+			_mm256_storeu_si256((__m256i*)(out + i), (__m256i)_mm512_cvtneps_pbh(_mm512_loadu_ps(in + i)));
+		for (int i = vecEnd; i < size; i++)
+			out[i] = Native::FloatToBF16(in[i]);
+	}
+
+	GGL_TARGET_AVX512BF16 void BF16PanelLinear_AVX512BF16(
+		const uint16_t* in, int inStride, float* out, int outStride, int numRows,
+		const uint16_t* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU, float negativeSlope) {
+
+		static_assert(Native::PANEL_WIDTH == 32, "BF16PanelLinear_AVX512BF16 assumes 2 vectors per panel");
+		constexpr int P = Native::PANEL_WIDTH;
+		__m512 slopeVec = _mm512_set1_ps(negativeSlope);
+		int numPairs = Native::GetBF16PaddedSize(inSize) / 2;
+
+		for (int p = 0; p < paddedOutSize; p += P) {
+			const uint16_t* panel = panels + (size_t)p * numPairs * 2;
+			for (int r = 0; r < numRows; r++) {
+				const uint16_t* x = in + (size_t)r * inStride;
+
+				// Each dpbf16 handles one input pair for 16 outputs, two sets of accumulators to hide latency
+				__m512 a0 = _mm512_loadu_ps(bias + p), a1 = _mm512_loadu_ps(bias + p + 16);
+				__m512 b0 = _mm512_setzero_ps(), b1 = _mm512_setzero_ps();
+
+				int kp = 0;
+				for (; kp + 2 <= numPairs; kp += 2) {
+					const uint16_t* w = panel + (size_t)kp * P * 2;
+					uint32_t pair0, pair1;
+					memcpy(&pair0, x + kp * 2, sizeof(pair0));
+					memcpy(&pair1, x + kp * 2 + 2, sizeof(pair1));
+					__m512bh x0 = AsBF16Vec(_mm512_set1_epi32((int)pair0)), x1 = AsBF16Vec(_mm512_set1_epi32((int)pair1));
+					a0 = _mm512_dpbf16_ps(a0, x0, AsBF16Vec(_mm512_loadu_si512(w + 0)));
+					a1 = _mm512_dpbf16_ps(a1, x0, AsBF16Vec(_mm512_loadu_si512(w + 32)));
+					b0 = _mm512_dpbf16_ps(b0, x1, AsBF16Vec(_mm512_loadu_si512(w + 64)));
+					b1 = _mm512_dpbf16_ps(b1, x1, AsBF16Vec(_mm512_loadu_si512(w + 96)));
+				}
+				for (; kp < numPairs; kp++) {
+					const uint16_t* w = panel + (size_t)kp * P * 2;
+					uint32_t pair;
+					memcpy(&pair, x + kp * 2, sizeof(pair));
+					__m512bh x0 = AsBF16Vec(_mm512_set1_epi32((int)pair));
+					a0 = _mm512_dpbf16_ps(a0, x0, AsBF16Vec(_mm512_loadu_si512(w + 0)));
+					a1 = _mm512_dpbf16_ps(a1, x0, AsBF16Vec(_mm512_loadu_si512(w + 32)));
+				}
+
+				a0 = _mm512_add_ps(a0, b0);
+				a1 = _mm512_add_ps(a1, b1);
+
+				if (fuseReLU) {
+					a0 = _mm512_max_ps(a0, _mm512_mul_ps(a0, slopeVec));
+					a1 = _mm512_max_ps(a1, _mm512_mul_ps(a1, slopeVec));
+				}
+
+				float* o = out + (size_t)r * outStride + p;
+				_mm512_storeu_ps(o + 0, a0);
+				_mm512_storeu_ps(o + 16, a1);
+			}
+		}
+	}
+#endif // GGL_NATIVE_X86
+
+	bool UseBF16Kernels() {
+		return g_ISA == Native::KernelISA::AVX512 && Native::GetCPUFeatures().avx512bf16;
+	}
+
+} // anonymous namespace
+
+const GGL::Native::CPUFeatures& GGL::Native::GetCPUFeatures() {
+	static CPUFeatures features = DetectCPUFeatures();
+	return features;
+}
+
+const char* GGL::Native::GetKernelISAName(KernelISA isa) {
+	switch (isa) {
+	case KernelISA::SCALAR: return "scalar";
+	case KernelISA::AVX2:   return "AVX2";
+	case KernelISA::AVX512: return "AVX-512";
+	}
+	return "unknown";
+}
+
+GGL::Native::KernelISA GGL::Native::GetKernelISA() {
+	return g_ISA;
+}
+
+void GGL::Native::SetKernelISA(KernelISA isa) {
+	g_ISA = RS_MIN(isa, DetectBestISA());
+}
+
+void GGL::Native::Linear(const float* in, const float* weight, const float* bias, float* out, int inSize, int outSize) {
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: return Linear_AVX512(in, weight, bias, out, inSize, outSize, NULL);
+	case KernelISA::AVX2:   return Linear_AVX2(in, weight, bias, out, inSize, outSize, NULL);
+#endif
+	default:                return Linear_Scalar(in, weight, bias, out, inSize, outSize, NULL);
+	}
+}
+
+void GGL::Native::SparseLinear(const float* in, const float* weight, const float* bias, float* out, int inSize, const int* rows, int numRows) {
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: return Linear_AVX512(in, weight, bias, out, inSize, numRows, rows);
+	case KernelISA::AVX2:   return Linear_AVX2(in, weight, bias, out, inSize, numRows, rows);
+#endif
+	default:                return Linear_Scalar(in, weight, bias, out, inSize, numRows, rows);
+	}
+}
+
+void GGL::Native::LayerNorm(float* data, const float* gamma, const float* beta, int size, float eps, bool fuseReLU, float negativeSlope) {
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: return LayerNorm_AVX512(data, gamma, beta, size, eps, fuseReLU, negativeSlope);
+	case KernelISA::AVX2:   return LayerNorm_AVX2(data, gamma, beta, size, eps, fuseReLU, negativeSlope);
+#endif
+	default:                return LayerNorm_Scalar(data, gamma, beta, size, eps, fuseReLU, negativeSlope);
+	}
+}
+
+void GGL::Native::PackPanels(const float* weight, int inSize, int outSize, float* outPanels) {
+	int paddedOutSize = GetPanelPaddedSize(outSize);
+	for (int o = 0; o < paddedOutSize; o++) {
+		float* dst = outPanels + (size_t)(o / PANEL_WIDTH) * inSize * PANEL_WIDTH + (o % PANEL_WIDTH);
+		for (int k = 0; k < inSize; k++)
+			dst[(size_t)k * PANEL_WIDTH] = (o < outSize) ? weight[(size_t)o * inSize + k] : 0;
+	}
+}
+
+void GGL::Native::ConvertToBF16(const float* in, int size, int paddedSize, uint16_t* out) {
+#ifdef GGL_NATIVE_X86
+	if (UseBF16Kernels()) {
+		ConvertToBF16_AVX512BF16(in, size, out);
+	} else
+#endif
+	{
+		for (int i = 0; i < size; i++)
+			out[i] = FloatToBF16(in[i]);
+	}
+
+	for (int i = size; i < paddedSize; i++)
+		out[i] = 0;
+}
+
+void GGL::Native::PackBF16Panels(const float* weight, int inSize, int outSize, uint16_t* outPanels) {
+	int paddedInSize = GetBF16PaddedSize(inSize);
+	int paddedOutSize = GetPanelPaddedSize(outSize);
+	for (int o = 0; o < paddedOutSize; o++) {
+		uint16_t* dst = outPanels + (size_t)(o / PANEL_WIDTH) * paddedInSize * PANEL_WIDTH + (o % PANEL_WIDTH) * 2;
+		for (int k = 0; k < paddedInSize; k++) {
+			float val = (o < outSize && k < inSize) ? weight[(size_t)o * inSize + k] : 0;
+			dst[(size_t)(k / 2) * PANEL_WIDTH * 2 + (k % 2)] = FloatToBF16(val);
+		}
+	}
+}
+
+void GGL::Native::BF16PanelLinear(
+	const uint16_t* in, int inStride, float* out, int outStride, int numRows,
+	const uint16_t* panels, const float* bias, int inSize, int paddedOutSize,
+	bool fuseReLU, float negativeSlope) {
+
+#ifdef GGL_NATIVE_X86
+	if (UseBF16Kernels())
+		return BF16PanelLinear_AVX512BF16(in, inStride, out, outStride, numRows, panels, bias, inSize, paddedOutSize, fuseReLU, negativeSlope);
+#endif
+	BF16PanelLinear_Scalar(in, inStride, out, outStride, numRows, panels, bias, inSize, paddedOutSize, fuseReLU, negativeSlope);
+}
+
+void GGL::Native::PanelLinear(
+	const float* in, int inStride, float* out, int outStride, int numRows,
+	const float* panels, const float* bias, int inSize, int paddedOutSize,
+	bool fuseReLU, float negativeSlope) {
+
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: return PanelLinear_AVX512(in, inStride, out, outStride, numRows, panels, bias, inSize, paddedOutSize, fuseReLU, negativeSlope);
+	case KernelISA::AVX2:   return PanelLinear_AVX2(in, inStride, out, outStride, numRows, panels, bias, inSize, paddedOutSize, fuseReLU, negativeSlope);
+#endif
+	default:                return PanelLinear_Scalar(in, inStride, out, outStride, numRows, panels, bias, inSize, paddedOutSize, fuseReLU, negativeSlope);
+	}
+}
+
+void GGL::Native::Activation(float* data, int size, ModelActivationType type, float negativeSlope) {
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: return Activation_AVX512(data, size, type, negativeSlope);
+	case KernelISA::AVX2:   return Activation_AVX2(data, size, type, negativeSlope);
+#endif
+	default:                return Activation_Scalar(data, size, type, negativeSlope);
+	}
+}
+
+float GGL::Native::AbsMax(const float* data, int size) {
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: return AbsMax_AVX512(data, size);
+	case KernelISA::AVX2:   return AbsMax_AVX2(data, size);
+#endif
+	default:                return AbsMax_Scalar(data, size);
+	}
+}
+
+void GGL::Native::QuantizeRow(const float* in, int size, int paddedSize, float scale, int8_t* out) {
+	float invScale = (scale > 0) ? (1 / scale) : 0;
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512: QuantizeRow_AVX512(in, size, invScale, out); break;
+	case KernelISA::AVX2:   QuantizeRow_AVX2(in, size, invScale, out); break;
+#endif
+	default:                QuantizeRow_Scalar(in, size, invScale, out); break;
+	}
+	memset(out + size, 0, paddedSize - size);
+}
+
+void GGL::Native::PackInt8Panels(const int8_t* weight, int outSize, int paddedInSize, int8_t* out) {
+	constexpr int P = INT8_PANEL_WIDTH, K = INT8_K_GROUP;
+	int paddedOutSize = GetInt8PaddedOutSize(outSize);
+	for (int o = 0; o < paddedOutSize; o++) {
+		int8_t* panel = out + (size_t)(o / P) * P * paddedInSize;
+		int j = o % P;
+		for (int i = 0; i < paddedInSize; i++)
+			panel[(i / K) * P * K + j * K + (i % K)] = (o < outSize) ? weight[(size_t)o * paddedInSize + i] : 0;
+	}
+}
+
+void GGL::Native::Int8Linear(
+	const int8_t* in, const int8_t* panels, const int32_t* weightSums, const float* weightScales, float inScale,
+	const float* bias, float* out, int paddedInSize, int paddedOutSize) {
+
+	switch (g_ISA) {
+#ifdef GGL_NATIVE_X86
+	case KernelISA::AVX512:
+		if (GetCPUFeatures().avx512vnni)
+			return Int8Linear_AVX512VNNI(in, panels, weightSums, weightScales, inScale, bias, out, paddedInSize, paddedOutSize);
+		[[fallthrough]];
+	case KernelISA::AVX2:
+		return Int8Linear_AVX2(in, panels, weightSums, weightScales, inScale, bias, out, paddedInSize, paddedOutSize);
+#endif
+	default:
+		return Int8Linear_Scalar(in, panels, weightSums, weightScales, inScale, bias, out, paddedInSize, paddedOutSize);
+	}
+}
+
+int GGL::Native::MaskedArgmax(const float* values, const uint8_t* mask, int size) {
+	int best = -1;
+	float bestVal = 0;
+	for (int i = 0; i < size; i++) {
+		if (mask[i] && (best == -1 || values[i] > bestVal)) {
+			best = i;
+			bestVal = values[i];
+		}
+	}
+	return best;
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <GigaLearnCPP/InferenceModelConfig.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+// Hand-written CPU kernels used by the native inference backend
+// Everything is runtime-dispatched, so the same exe runs on any x86-64 CPU (and non-x86 through the scalar path)
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define GGL_NATIVE_X86
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC allows any intrinsic without per-function targets
+#define GGL_TARGET_AVX2
+#define GGL_TARGET_AVX512
+#define GGL_TARGET_AVX512VNNI
+#define GGL_TARGET_AVX512BF16
+#else
+#define GGL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GGL_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define GGL_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512vnni,avx2,fma")))
+#define GGL_TARGET_AVX512BF16 __attribute__((target("avx512f,avx512bw,avx512bf16,avx2,fma")))
+#endif
+
+namespace GGL::Native {
+
+	constexpr size_t SIMD_ALIGN = 64;
+
+	struct CPUFeatures {
+		bool avx2 = false;
+		bool fma = false;
+		bool avx512f = false;
+		bool avx512bw = false;
+		bool avx512vnni = false;
+		bool avx512bf16 = false;
+		bool amxBF16 = false;
+	};
+
+	// Detected once, includes OS support for the extended register state
+	const CPUFeatures& GetCPUFeatures();
+
+	// True if this CPU has native bf16 dot products (AVX512-BF16 or AMX)
+	inline bool HasFastBF16() {
+		return GetCPUFeatures().avx512bf16 || GetCPUFeatures().amxBF16;
+	}
+
+	enum class KernelISA {
+		SCALAR,
+		AVX2,
+		AVX512
+	};
+
+	const char* GetKernelISAName(KernelISA isa);
+
+	// Best ISA supported by this CPU
+	KernelISA GetKernelISA();
+
+	// Forces a specific ISA (clamped to what the CPU supports), mostly for parity checks
+	void SetKernelISA(KernelISA isa);
+
+	// out[o] = bias[o] + dot(weight[o, :], in)
+	// weight is row-major [outSize, inSize], bias can be null
+	void Linear(const float* in, const float* weight, const float* bias, float* out, int inSize, int outSize);
+
+	// Linear() for only the listed output rows, out[rows[i]] is written and everything else is left untouched
+	void SparseLinear(const float* in, const float* weight, const float* bias, float* out, int inSize, const int* rows, int numRows);
+
+	// In-place LayerNorm over one row
+	// If fuseReLU is set, max(x, x * negativeSlope) is applied in the same pass (ReLU or LeakyReLU)
+	void LayerNorm(float* data, const float* gamma, const float* beta, int size, float eps, bool fuseReLU = false, float negativeSlope = 0);
+
+	// In-place activation
+	void Activation(float* data, int size, ModelActivationType type, float negativeSlope);
+
+	// Outputs per weight panel, see PackPanels()
+	constexpr int PANEL_WIDTH = 32;
+
+	inline int GetPanelPaddedSize(int size) {
+		return (size + PANEL_WIDTH - 1) / PANEL_WIDTH * PANEL_WIDTH;
+	}
+
+	// Packs row-major [outSize, inSize] weights into panels of PANEL_WIDTH outputs
+	// Output o, input k ends up at outPanels[(o / PANEL_WIDTH) * inSize * PANEL_WIDTH + k * PANEL_WIDTH + (o % PANEL_WIDTH)]
+	// outPanels needs GetPanelPaddedSize(outSize) * inSize floats, padding outputs are zeroed
+	void PackPanels(const float* weight, int inSize, int outSize, float* outPanels);
+
+	// Batched linear over panel-packed weights: out[r, o] = bias[o] + dot(in[r, :], W[o, :])
+	// Each panel is streamed once for all rows, bias must be padded to paddedOutSize
+	// If fuseReLU is set, max(x, x * negativeSlope) is applied before storing
+	void PanelLinear(
+		const float* in, int inStride, float* out, int outStride, int numRows,
+		const float* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU = false, float negativeSlope = 0
+	);
+
+	// bf16 is stored as the upper 16 bits of a float, rounded to nearest even
+	inline uint16_t FloatToBF16(float f) {
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		bits += 0x7FFF + ((bits >> 16) & 1);
+		return (uint16_t)(bits >> 16);
+	}
+
+	inline float BF16ToFloat(uint16_t v) {
+		uint32_t bits = (uint32_t)v << 16;
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	// BF16 panels store inputs in pairs, so inputs are padded to an even count
+	inline int GetBF16PaddedSize(int size) {
+		return (size + 1) & ~1;
+	}
+
+	// Converts a row to bf16, zero-filled from size to paddedSize
+	void ConvertToBF16(const float* in, int size, int paddedSize, uint16_t* out);
+
+	// Same as PackPanels(), but in bf16 with each pair of inputs stored together per output: [paddedInSize / 2][PANEL_WIDTH][2]
+	// outPanels needs GetPanelPaddedSize(outSize) * GetBF16PaddedSize(inSize) values
+	void PackBF16Panels(const float* weight, int inSize, int outSize, uint16_t* outPanels);
+
+	// PanelLinear() over bf16 inputs and weights, accumulating in fp32
+	// in rows are bf16 (see ConvertToBF16()) with inStride in values, padded to GetBF16PaddedSize(inSize)
+	// Only fast on AVX512-BF16 CPUs, elsewhere it runs a scalar emulation
+	void BF16PanelLinear(
+		const uint16_t* in, int inStride, float* out, int outStride, int numRows,
+		const uint16_t* panels, const float* bias, int inSize, int paddedOutSize,
+		bool fuseReLU = false, float negativeSlope = 0
+	);
+
+	// INT8 weights are packed into panels of INT8_PANEL_WIDTH outputs
+	// Within a panel, each group of INT8_K_GROUP inputs is stored contiguously per output: [paddedInSize / K][P][K]
+	constexpr int INT8_PANEL_WIDTH = 16;
+	constexpr int INT8_K_GROUP = 4;
+
+	inline int GetInt8PaddedSize(int size) {
+		return (size + INT8_K_GROUP - 1) / INT8_K_GROUP * INT8_K_GROUP;
+	}
+
+	inline int GetInt8PaddedOutSize(int size) {
+		return (size + INT8_PANEL_WIDTH - 1) / INT8_PANEL_WIDTH * INT8_PANEL_WIDTH;
+	}
+
+	float AbsMax(const float* data, int size);
+
+	// out[i] = clamp(round(in[i] / scale), -127, 127), rounding half to even, zero-filled from size to paddedSize
+	void QuantizeRow(const float* in, int size, int paddedSize, float scale, int8_t* out);
+
+	// Packs row-major int8 weights [outSize, paddedInSize] into panels, zero-filled up to GetInt8PaddedOutSize(outSize)
+	void PackInt8Panels(const int8_t* weight, int outSize, int paddedInSize, int8_t* out);
+
+	// out[o] = bias[o] + inScale * weightScales[o] * dot(in, weight[o, :]), with an int32 dot product
+	// weightSums[o] is the sum of weight[o, :], needed by the VNNI path (which works on unsigned inputs)
+	// weightSums, weightScales, bias and out all cover paddedOutSize
+	void Int8Linear(
+		const int8_t* in, const int8_t* panels, const int32_t* weightSums, const float* weightScales, float inScale,
+		const float* bias, float* out, int paddedInSize, int paddedOutSize
+	);
+
+	// Index of the largest enabled value, or -1 if nothing is enabled
+	int MaskedArgmax(const float* values, const uint8_t* mask, int size);
+
+	/////////////////////////////////////////////
+
+	inline void* AlignedAlloc(size_t bytes, size_t align = SIMD_ALIGN) {
+		bytes = (bytes + align - 1) / align * align;
+#if defined(_MSC_VER)
+		void* result = _aligned_malloc(bytes, align);
+#else
+		void* result = std::aligned_alloc(align, bytes);
+#endif
+		if (!result && bytes > 0)
+			throw std::bad_alloc();
+		return result;
+	}
+
+	inline void AlignedFree(void* ptr) {
+#if defined(_MSC_VER)
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+
+	// Lets std::vector hand out SIMD-aligned storage
+	// A larger alignment (e.g. a huge page) also rounds every allocation up to a multiple of it
+	template <typename T>
+	struct AlignedAllocator {
+		typedef T value_type;
+
+		// The alignment moves with the storage, so vectors can swap or move between alignments
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		size_t align = SIMD_ALIGN;
+
+		AlignedAllocator() = default;
+		explicit AlignedAllocator(size_t align) : align(align) {}
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U>& other) : align(other.align) {}
+
+		T* allocate(size_t n) {
+			return (T*)AlignedAlloc(n * sizeof(T), align);
+		}
+
+		void deallocate(T* ptr, size_t) {
+			AlignedFree(ptr);
+		}
+
+		template <typename U>
+		bool operator==(const AlignedAllocator<U>& other) const { return align == other.align; }
+		template <typename U>
+		bool operator!=(const AlignedAllocator<U>& other) const { return align != other.align; }
+	};
+
+	template <typename T>
+	using AlignedVec = std::vector<T, AlignedAllocator<T>>;
+
+	// Reserves a zeroed, SIMD-aligned block at the end of a weight arena, returns its offset
+	// Offsets stay valid as the arena grows, pointers don't
+	template <typename T>
+	size_t ArenaAlloc(AlignedVec<T>& arena, size_t size) {
+		constexpr size_t ALIGN_ELEMS = SIMD_ALIGN / sizeof(T);
+		size_t offset = (arena.size() + ALIGN_ELEMS - 1) / ALIGN_ELEMS * ALIGN_ELEMS;
+		arena.resize(offset + size, 0);
+		return offset;
+	}
+}
@@ -0,0 +1,78 @@
+#include "ObsRecording.h"
+
+namespace {
+	bool ReadHeader(std::ifstream& in, int& obsSize, int& numActions) {
+		char magic[sizeof(GGL::OBS_RECORDING_MAGIC)];
+		int32_t sizes[2];
+		if (!in.read(magic, sizeof(magic)) || !in.read((char*)sizes, sizeof(sizes)))
+			return false;
+		if (memcmp(magic, GGL::OBS_RECORDING_MAGIC, sizeof(magic)) != 0)
+			return false;
+
+		obsSize = sizes[0];
+		numActions = sizes[1];
+		return true;
+	}
+}
+
+GGL::ObsRecordWriter::ObsRecordWriter(const std::filesystem::path& path, int obsSize, int numActions) :
+	obsSize(obsSize), numActions(numActions) {
+
+	bool append = false;
+	if (std::filesystem::exists(path)) {
+		std::ifstream in(path, std::ios::binary);
+		int fileObsSize, fileNumActions;
+		if (!ReadHeader(in, fileObsSize, fileNumActions))
+			RG_ERR_CLOSE("ObsRecordWriter: " << path << " exists but is not an obs recording");
+		if (fileObsSize != obsSize || fileNumActions != numActions) {
+			RG_ERR_CLOSE(
+				"ObsRecordWriter: " << path << " was recorded with obs size " << fileObsSize << " and " << fileNumActions <<
+				" actions, expected " << obsSize << " and " << numActions
+			);
+		}
+		append = true;
+	}
+
+	_out.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+	if (!_out.good())
+		RG_ERR_CLOSE("ObsRecordWriter: Failed to open " << path << " for writing");
+
+	if (!append) {
+		int32_t sizes[2] = { obsSize, numActions };
+		_out.write(OBS_RECORDING_MAGIC, sizeof(OBS_RECORDING_MAGIC));
+		_out.write((const char*)sizes, sizeof(sizes));
+	}
+}
+
+void GGL::ObsRecordWriter::Write(const float* obs, const uint8_t* actionMasks, int count) {
+	for (int i = 0; i < count; i++) {
+		_out.write((const char*)(obs + (size_t)i * obsSize), obsSize * sizeof(float));
+		_out.write((const char*)(actionMasks + (size_t)i * numActions), numActions);
+	}
+}
+
+GGL::ObsRecording GGL::ObsRecording::Load(const std::filesystem::path& path) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good())
+		RG_ERR_CLOSE("ObsRecording::Load(): Failed to open " << path);
+
+	ObsRecording result = {};
+	if (!ReadHeader(in, result.obsSize, result.numActions))
+		RG_ERR_CLOSE("ObsRecording::Load(): " << path << " is not an obs recording");
+
+	size_t recordBytes = result.obsSize * sizeof(float) + result.numActions;
+	size_t dataBytes = std::filesystem::file_size(path) - (sizeof(OBS_RECORDING_MAGIC) + sizeof(int32_t) * 2);
+	result.numRecords = (int)(dataBytes / recordBytes);
+
+	result.obs.resize((size_t)result.numRecords * result.obsSize);
+	result.actionMasks.resize((size_t)result.numRecords * result.numActions);
+	for (int i = 0; i < result.numRecords; i++) {
+		in.read((char*)(result.obs.data() + (size_t)i * result.obsSize), result.obsSize * sizeof(float));
+		in.read((char*)(result.actionMasks.data() + (size_t)i * result.numActions), result.numActions);
+	}
+
+	if (!in.good())
+		RG_ERR_CLOSE("ObsRecording::Load(): Failed to read " << path);
+
+	return result;
+}
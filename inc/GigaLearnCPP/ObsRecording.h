@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GigaLearnCPP/Framework.h>
+#include <filesystem>
+#include <fstream>
+
+namespace GGL {
+
+	// Binary file of observations + action masks captured from real matches (used for INT8 calibration)
+	// Layout: 8-byte magic, int32 obsSize, int32 numActions, then per record: [obsSize floats][numActions mask bytes]
+	constexpr char OBS_RECORDING_MAGIC[8] = { 'G', 'G', 'L', 'O', 'B', 'S', '0', '1' };
+
+	class ObsRecordWriter {
+	public:
+		int obsSize, numActions;
+
+		// Appends if the file already exists with a matching header
+		ObsRecordWriter(const std::filesystem::path& path, int obsSize, int numActions);
+
+		void Write(const float* obs, const uint8_t* actionMasks, int count);
+
+	private:
+		std::ofstream _out;
+	};
+
+	struct ObsRecording {
+		int obsSize = 0, numActions = 0;
+		int numRecords = 0;
+		std::vector<float> obs;           // [numRecords, obsSize]
+		std::vector<uint8_t> actionMasks; // [numRecords, numActions]
+
+		static ObsRecording Load(const std::filesystem::path& path);
+	};
+}
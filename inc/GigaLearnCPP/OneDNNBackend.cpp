@@ -0,0 +1,113 @@
+#include "OneDNNBackend.h"
+
+#include <GigaLearnCPP/Models.h>
+#include <GigaLearnCPP/InferPlan.h>
+
+#include <random>
+
+using namespace GGL;
+
+bool GGL::OneDNNInferenceBackend::IsAvailable() {
+	return at::hasMKLDNN();
+}
+
+GGL::OneDNNInferenceBackend::OneDNNInferenceBackend(ModelSet& models, int obsSize, int numActions) :
+	InferenceBackend(obsSize, numActions), _rng(std::random_device{}()) {
+
+	RG_NO_GRAD;
+
+	if (!IsAvailable())
+		RG_ERR_CLOSE("OneDNNInferenceBackend: This libtorch build has no oneDNN support");
+
+	Native::Network network = {};
+	if (models["shared_head"])
+		network.AppendModel(*models["shared_head"]);
+	network.AppendModel(*models["policy"]);
+
+	if (network.numInputs != obsSize || network.numOutputs != numActions) {
+		RG_ERR_CLOSE(
+			"OneDNNInferenceBackend: Network maps " << network.numInputs << " -> " << network.numOutputs <<
+			", expected " << obsSize << " -> " << numActions
+		);
+	}
+
+	for (auto& layer : network.layers) {
+		Op op = {};
+		op.size = layer.outSize;
+
+		switch (layer.type) {
+		case Native::Layer::Type::LINEAR:
+			op.type = Op::Type::LINEAR;
+
+			// Same as torch.utils.mkldnn.MkldnnLinear, the reorder into oneDNN's layout happens here and never again
+			op.weight = PTR_TO_TENSOR(layer.weight.data(), { layer.outSize, layer.inSize }).to_mkldnn();
+			if (!layer.bias.empty())
+				op.bias = PTR_TO_TENSOR(layer.bias.data(), { layer.outSize }).to_mkldnn();
+			break;
+
+		case Native::Layer::Type::LAYER_NORM:
+			op.type = Op::Type::LAYER_NORM;
+			op.weight = PTR_TO_TENSOR(layer.weight.data(), { layer.outSize });
+			op.bias = PTR_TO_TENSOR(layer.bias.data(), { layer.outSize });
+			op.eps = layer.eps;
+			break;
+
+		case Native::Layer::Type::ACTIVATION:
+			op.type = Op::Type::ACTIVATION;
+			op.activationType = layer.activationType;
+			op.negativeSlope = layer.negativeSlope;
+			break;
+		}
+
+		ops.push_back(std::move(op));
+	}
+
+	_logits.resize(numActions);
+}
+
+void GGL::OneDNNInferenceBackend::InferLogits(const float* obs, int batchSize, float* outLogits) {
+	RG_NO_GRAD;
+
+	auto x = PTR_TO_TENSOR_VIEW(obs, batchSize, obsSize).to_mkldnn();
+
+	for (auto& op : ops) {
+		switch (op.type) {
+		case Op::Type::LINEAR:
+			x = at::mkldnn_linear(x, op.weight, op.bias.defined() ? c10::optional<torch::Tensor>(op.bias) : c10::nullopt);
+			break;
+
+		case Op::Type::LAYER_NORM:
+			// oneDNN tensors have no LayerNorm kernel in libtorch
+			// The activations are plain [batch, features] here, so the round trip is just two row copies
+			x = torch::layer_norm(x.to_dense(), { op.size }, op.weight, op.bias, op.eps).to_mkldnn();
+			break;
+
+		case Op::Type::ACTIVATION:
+			switch (op.activationType) {
+			case ModelActivationType::RELU:       x = torch::relu(x);    break;
+			case ModelActivationType::SIGMOID:    x = torch::sigmoid(x); break;
+			case ModelActivationType::TANH:       x = torch::tanh(x);    break;
+			case ModelActivationType::LEAKY_RELU:
+				x = torch::leaky_relu(x.to_dense(), op.negativeSlope).to_mkldnn();
+				break;
+			}
+			break;
+		}
+	}
+
+	// Only the logits ever leave oneDNN layout
+	auto logits = x.to_dense().contiguous();
+	memcpy(outLogits, logits.data_ptr<float>(), (size_t)batchSize * numActions * sizeof(float));
+}
+
+void GGL::OneDNNInferenceBackend::InferActions(
+	const float* obs, const uint8_t* actionMasks, int batchSize,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	if (_logits.size() < (size_t)batchSize * numActions)
+		_logits.resize((size_t)batchSize * numActions);
+
+	InferLogits(obs, batchSize, _logits.data());
+	SelectMaskedActions(_logits.data(), numActions, actionMasks, batchSize, numActions, deterministic, temperature, outActions, outLogProbs, rngs, _rng);
+}
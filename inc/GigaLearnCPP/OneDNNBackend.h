@@ -0,0 +1,56 @@
+#pragma once
+
+#include "InferenceBackend.h"
+#include "NativeKernels.h"
+
+#include <torch/torch.h>
+
+namespace GGL {
+
+	// Runs shared_head + policy through libtorch's oneDNN (mkldnn) kernels, CPU only
+	// Linear weights are converted to oneDNN tensors once at load, and activations stay in oneDNN layout between layers
+	class OneDNNInferenceBackend : public InferenceBackend {
+	public:
+		struct Op {
+			enum class Type {
+				LINEAR,
+				LAYER_NORM,
+				ACTIVATION
+			};
+
+			Type type;
+
+			// LINEAR: oneDNN weight/bias
+			// LAYER_NORM: dense gamma/beta
+			torch::Tensor weight, bias;
+			int64_t size = 0;
+			double eps = 1e-5;
+
+			ModelActivationType activationType = ModelActivationType::RELU;
+			double negativeSlope = 0.01;
+		};
+
+		std::vector<Op> ops;
+
+		OneDNNInferenceBackend(ModelSet& models, int obsSize, int numActions);
+
+		virtual const char* GetName() const override { return "libtorch-onednn"; }
+
+		virtual bool UsesIntraOpThreads() const override { return true; }
+
+		// False if this libtorch build has no oneDNN
+		static bool IsAvailable();
+
+		virtual void InferLogits(const float* obs, int batchSize, float* outLogits) override;
+
+		virtual void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) override;
+
+	private:
+		Native::AlignedVec<float> _logits;
+		FastRNG _rng;
+	};
+}
@@ -0,0 +1,168 @@
+#include "QuantPlan.h"
+
+using namespace GGL;
+
+GGL::Native::QuantPlan GGL::Native::QuantPlan::Compile(const Network& network) {
+	QuantPlan plan = {};
+	plan.numInputs = network.numInputs;
+	plan.numOutputs = network.numOutputs;
+
+	auto& layers = network.layers;
+	for (size_t i = 0; i < layers.size();) {
+		auto& linear = layers[i];
+		if (linear.type != Layer::Type::LINEAR)
+			RG_ERR_CLOSE("QuantPlan::Compile(): Expected a linear layer at index " << i << ", got layer type " << (int)linear.type);
+		i++;
+
+		QuantOp op = {};
+		op.inSize = linear.inSize;
+		op.paddedInSize = GetInt8PaddedSize(linear.inSize);
+		op.outSize = linear.outSize;
+		op.paddedOutSize = GetInt8PaddedOutSize(linear.outSize);
+
+		// Symmetric per-output-channel scales
+		std::vector<int8_t> rowMajor((size_t)op.outSize * op.paddedInSize);
+		op.weightSumOffset = ArenaAlloc(plan.weightSums, op.paddedOutSize);
+		op.weightScaleOffset = ArenaAlloc(plan.params, op.paddedOutSize);
+		for (int o = 0; o < op.outSize; o++) {
+			const float* row = linear.weight.data() + (size_t)o * op.inSize;
+			float scale = AbsMax(row, op.inSize) / 127;
+			plan.params[op.weightScaleOffset + o] = scale;
+
+			int8_t* quantRow = rowMajor.data() + (size_t)o * op.paddedInSize;
+			QuantizeRow(row, op.inSize, op.paddedInSize, scale, quantRow);
+
+			int32_t sum = 0;
+			for (int j = 0; j < op.inSize; j++)
+				sum += quantRow[j];
+			plan.weightSums[op.weightSumOffset + o] = sum;
+		}
+
+		op.weightOffset = ArenaAlloc(plan.weights, (size_t)op.paddedOutSize * op.paddedInSize);
+		PackInt8Panels(rowMajor.data(), op.outSize, op.paddedInSize, plan.weights.data() + op.weightOffset);
+
+		op.biasOffset = ArenaAlloc(plan.params, op.paddedOutSize);
+		if (!linear.bias.empty())
+			std::copy(linear.bias.begin(), linear.bias.end(), plan.params.begin() + op.biasOffset);
+
+		if (i < layers.size() && layers[i].type == Layer::Type::LAYER_NORM) {
+			auto& layerNorm = layers[i];
+			op.hasLayerNorm = true;
+			op.eps = layerNorm.eps;
+			op.gammaOffset = ArenaAlloc(plan.params, op.outSize);
+			std::copy(layerNorm.weight.begin(), layerNorm.weight.end(), plan.params.begin() + op.gammaOffset);
+			op.betaOffset = ArenaAlloc(plan.params, op.outSize);
+			std::copy(layerNorm.bias.begin(), layerNorm.bias.end(), plan.params.begin() + op.betaOffset);
+			i++;
+		}
+
+		if (i < layers.size() && layers[i].type == Layer::Type::ACTIVATION) {
+			op.hasActivation = true;
+			op.activationType = layers[i].activationType;
+			op.negativeSlope = layers[i].negativeSlope;
+			i++;
+		}
+
+		plan.maxWidth = RS_MAX(plan.maxWidth, RS_MAX(op.paddedOutSize, op.inSize));
+		plan.maxPaddedInSize = RS_MAX(plan.maxPaddedInSize, op.paddedInSize);
+		plan.ops.push_back(op);
+	}
+
+	if (plan.ops.empty())
+		RG_ERR_CLOSE("QuantPlan::Compile(): Network has no layers");
+
+	return plan;
+}
+
+void GGL::Native::QuantPlan::Calibrate(const float* obs, int numSamples) {
+	RG_ASSERT(numSamples > 0);
+
+	// Observe with dynamic scales, which track the fp32 activations closely
+	for (auto& op : ops)
+		op.inputScale = 0;
+
+	std::vector<float> absMax(ops.size(), 0.f);
+	AlignedVec<float> scratch(GetScratchSize(1));
+	for (int i = 0; i < numSamples; i++)
+		Forward(obs + (size_t)i * numInputs, 1, scratch.data(), absMax.data());
+
+	for (size_t i = 0; i < ops.size(); i++)
+		ops[i].inputScale = RS_MAX(absMax[i], 1e-6f) / 127;
+}
+
+const float* GGL::Native::QuantPlan::Forward(const float* in, int numRows, float* scratch, float* observedAbsMax) const {
+	float* buffers[2] = { scratch, scratch + (size_t)numRows * maxWidth };
+	int8_t* quantRow = (int8_t*)(scratch + 2 * (size_t)numRows * maxWidth);
+	int nextBuffer = 0;
+
+	const float* cur = in;
+	int curStride = numInputs;
+
+	for (size_t opIdx = 0; opIdx < ops.size(); opIdx++) {
+		auto& op = ops[opIdx];
+		float* out = buffers[nextBuffer];
+		nextBuffer ^= 1;
+
+		for (int r = 0; r < numRows; r++) {
+			const float* inRow = cur + (size_t)r * curStride;
+			float* outRow = out + (size_t)r * op.paddedOutSize;
+
+			float inScale = op.inputScale;
+			if (inScale <= 0 || observedAbsMax) {
+				float absMax = AbsMax(inRow, op.inSize);
+				if (observedAbsMax)
+					observedAbsMax[opIdx] = RS_MAX(observedAbsMax[opIdx], absMax);
+				if (inScale <= 0)
+					inScale = absMax / 127;
+			}
+
+			QuantizeRow(inRow, op.inSize, op.paddedInSize, inScale, quantRow);
+			Int8Linear(
+				quantRow, weights.data() + op.weightOffset, weightSums.data() + op.weightSumOffset, params.data() + op.weightScaleOffset, inScale,
+				params.data() + op.biasOffset, outRow, op.paddedInSize, op.paddedOutSize
+			);
+
+			if (op.hasLayerNorm)
+				LayerNorm(outRow, params.data() + op.gammaOffset, params.data() + op.betaOffset, op.outSize, op.eps);
+
+			if (op.hasActivation)
+				Activation(outRow, op.outSize, op.activationType, op.negativeSlope);
+		}
+
+		cur = out;
+		curStride = op.paddedOutSize;
+	}
+
+	return cur;
+}
+
+GGL::Native::QuantReport GGL::Native::CompareQuantPlan(
+	const InferPlan& reference, const QuantPlan& quant,
+	const float* obs, const uint8_t* actionMasks, int numSamples) {
+
+	RG_ASSERT(reference.numInputs == quant.numInputs && reference.numOutputs == quant.numOutputs);
+	int numActions = quant.numOutputs;
+
+	AlignedVec<float> refScratch(reference.GetScratchSize(1)), quantScratch(quant.GetScratchSize(1));
+
+	QuantReport report = {};
+	report.numSamples = numSamples;
+
+	int numAgreed = 0;
+	for (int i = 0; i < numSamples; i++) {
+		const float* curObs = obs + (size_t)i * quant.numInputs;
+		const uint8_t* mask = actionMasks + (size_t)i * numActions;
+
+		const float* refLogits = reference.Forward(curObs, 1, refScratch.data());
+		const float* quantLogits = quant.Forward(curObs, 1, quantScratch.data());
+
+		if (MaskedArgmax(refLogits, mask, numActions) == MaskedArgmax(quantLogits, mask, numActions))
+			numAgreed++;
+
+		for (int j = 0; j < numActions; j++)
+			report.maxLogitDiff = RS_MAX(report.maxLogitDiff, fabsf(refLogits[j] - quantLogits[j]));
+	}
+
+	report.argmaxAgreement = numSamples > 0 ? (numAgreed / (float)numSamples) : 0;
+	return report;
+}
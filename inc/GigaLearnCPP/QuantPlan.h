@@ -0,0 +1,69 @@
+#pragma once
+
+#include "InferPlan.h"
+
+namespace GGL::Native {
+
+	// One fused Linear -> [LayerNorm] -> [Activation] step with INT8 weights
+	struct QuantOp {
+		int inSize, paddedInSize, outSize, paddedOutSize;
+
+		// Offset into QuantPlan::weights (packed panels) and QuantPlan::weightSums, [paddedOutSize]
+		size_t weightOffset, weightSumOffset;
+
+		// Offsets into QuantPlan::params, weight scales and bias cover paddedOutSize
+		size_t weightScaleOffset, biasOffset;
+		size_t gammaOffset = 0, betaOffset = 0;
+
+		bool hasLayerNorm = false;
+		float eps = 1e-5f;
+
+		bool hasActivation = false;
+		ModelActivationType activationType = ModelActivationType::RELU;
+		float negativeSlope = 0;
+
+		// Calibrated activation scale for this op's input, 0 means a dynamic per-row scale
+		float inputScale = 0;
+	};
+
+	// INT8 version of InferPlan: per-output-channel symmetric weights, activations quantized per op
+	// LayerNorm, bias and activations stay in fp32
+	struct QuantPlan {
+		std::vector<QuantOp> ops;
+		AlignedVec<int8_t> weights;
+		AlignedVec<int32_t> weightSums;
+		AlignedVec<float> params;
+		int numInputs = 0, numOutputs = 0;
+		int maxWidth = 0, maxPaddedInSize = 0;
+
+		static QuantPlan Compile(const Network& network);
+
+		bool IsCalibrated() const {
+			return !ops.empty() && ops[0].inputScale > 0;
+		}
+
+		// Sets static activation scales from the largest input each op sees over the given observations
+		void Calibrate(const float* obs, int numSamples);
+
+		// Number of floats of scratch needed by Forward()
+		size_t GetScratchSize(int numRows) const {
+			return 2 * (size_t)numRows * maxWidth + (maxPaddedInSize + sizeof(float) - 1) / sizeof(float);
+		}
+
+		int GetOutputStride() const {
+			return ops.back().paddedOutSize;
+		}
+
+		// Output row stride is GetOutputStride()
+		// If observedAbsMax is set, the largest input value per op is accumulated into it
+		const float* Forward(const float* in, int numRows, float* scratch, float* observedAbsMax = NULL) const;
+	};
+
+	struct QuantReport {
+		int numSamples = 0;
+		float argmaxAgreement = 0; // Fraction of samples where the masked argmax matches fp32
+		float maxLogitDiff = 0;
+	};
+
+	QuantReport CompareQuantPlan(const InferPlan& reference, const QuantPlan& quant, const float* obs, const uint8_t* actionMasks, int numSamples);
+}
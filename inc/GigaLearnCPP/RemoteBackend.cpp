@@ -0,0 +1,258 @@
+#include "RemoteBackend.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+	// Per stat, past this only the counters keep updating until the next TakeStats()
+	constexpr size_t MAX_LATENCY_SAMPLES = 1 << 20;
+
+	// How often a client without a server looks for one again
+	constexpr uint64_t RECONNECT_INTERVAL_NS = 1'000'000'000ull;
+
+	// A waiting client spins this many times before it starts yielding its core
+	constexpr int WAIT_SPINS = 256;
+}
+
+GGL::RemoteInferenceBackend::RemoteInferenceBackend(const std::string& serverName, std::unique_ptr<InferenceBackend> localBackend, int timeoutUs) :
+	InferenceBackend(localBackend->obsSize, localBackend->numActions),
+	_local(std::move(localBackend)), _serverName(serverName), _timeoutUs(RS_MAX(timeoutUs, 1)) {
+
+	precision = _local->precision;
+	_fingerprint = GetBackendFingerprint(*_local);
+	_rng.Seed(std::random_device{}());
+
+	if (TryConnect(InferShm::GetNowNs())) {
+		RG_LOG("RemoteInferenceBackend: Connected to inference server \"" << _serverName << "\"");
+	} else {
+		RG_LOG("RemoteInferenceBackend: No inference server \"" << _serverName << "\" yet, running on " << _local->GetName() << " until one starts");
+	}
+}
+
+GGL::RemoteInferenceBackend::~RemoteInferenceBackend() {
+	auto stats = TakeStats();
+	if (stats.numRemoteCalls + stats.numLocalCalls > 0)
+		LogStats(stats);
+}
+
+bool GGL::RemoteInferenceBackend::TryConnect(uint64_t nowNs) {
+	using namespace InferShm;
+
+	if (nowNs < _nextConnectNs)
+		return false;
+	_nextConnectNs = nowNs + RECONNECT_INTERVAL_NS;
+
+	auto memory = SharedMemory::Open(GetSegmentName(_serverName));
+	if (!memory || memory->GetSize() < sizeof(Header))
+		return false;
+
+	auto header = (Header*)memory->GetData();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (header->magic != MAGIC || header->version != VERSION)
+		return false;
+
+	if (nowNs - RS_MIN(header->heartbeatNs.load(), nowNs) >= SERVER_STALE_NS)
+		return false;
+
+	if (header->obsSize != obsSize || header->numActions != numActions || header->fingerprint != _fingerprint) {
+		// Worth saying (once), since it's likely a server left running from before a model update
+		if (!_loggedMismatch) {
+			RG_LOG(
+				"RemoteInferenceBackend: Inference server \"" << _serverName << "\" runs a different model (" <<
+				header->obsSize << " -> " << header->numActions << ", fingerprint " << std::hex << header->fingerprint << ", ours is " << _fingerprint << std::dec <<
+				"), not using it"
+			);
+			_loggedMismatch = true;
+		}
+		return false;
+	}
+
+	if (memory->GetSize() < GetSegmentSize(header->obsSize, header->numActions, header->numSlots))
+		return false;
+
+	_memory = std::move(memory);
+	_header = header;
+	return true;
+}
+
+void GGL::RemoteInferenceBackend::Disconnect(const char* reason) {
+	RG_LOG("RemoteInferenceBackend: Lost inference server \"" << _serverName << "\" (" << reason << "), running on " << _local->GetName());
+	_header = NULL;
+	_memory.reset();
+	_nextConnectNs = InferShm::GetNowNs() + RECONNECT_INTERVAL_NS;
+}
+
+bool GGL::RemoteInferenceBackend::InferRemote(
+	const float* obs, const uint8_t* actionMasks, int batchSize, bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	using namespace InferShm;
+
+	uint64_t startNs = GetNowNs();
+
+	if (!_header) {
+		if (!TryConnect(startNs)) {
+			_stats.numNoServer++;
+			return false;
+		}
+		RG_LOG("RemoteInferenceBackend: Connected to inference server \"" << _serverName << "\"");
+	}
+
+	if (startNs - RS_MIN(_header->heartbeatNs.load(std::memory_order_relaxed), startNs) >= SERVER_STALE_NS) {
+		Disconnect("it stopped");
+		_stats.numNoServer++;
+		return false;
+	}
+
+	if (_slots.size() < (size_t)batchSize) {
+		_slots.resize(batchSize);
+		_actions.resize(batchSize);
+		_logProbs.resize(batchSize);
+		_rngs.resize(batchSize);
+	}
+
+	// Claim every slot up front, a partial batch would only be split across the server and the local backend
+	int numSlots = _header->numSlots;
+	uint32_t firstSlot = _header->nextSlot.fetch_add(batchSize, std::memory_order_relaxed);
+	int numClaimed = 0;
+	for (int i = 0; i < numSlots && numClaimed < batchSize; i++) {
+		Slot* slot = GetSlot(_header, (int)((firstSlot + i) % numSlots));
+		uint32_t expected = SLOT_FREE;
+		if (slot->state.load(std::memory_order_relaxed) == SLOT_FREE &&
+			slot->state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+			slot->requestNs = GetNowNs(); // So the server doesn't take this for a slot left by a dead client
+			_slots[numClaimed++] = slot;
+		}
+	}
+
+	if (numClaimed < batchSize) {
+		for (int i = 0; i < numClaimed; i++)
+			_slots[i]->state.store(SLOT_FREE, std::memory_order_release);
+		_stats.numSlotsFull++;
+		return false;
+	}
+
+	for (int i = 0; i < batchSize; i++) {
+		Slot* slot = _slots[i];
+		memcpy(GetSlotObs(slot), obs + (size_t)i * obsSize, obsSize * sizeof(float));
+		memcpy(GetSlotMask(slot, obsSize), actionMasks + (size_t)i * numActions, numActions);
+		slot->deterministic = deterministic;
+		slot->temperature = temperature;
+
+		FastRNG rowRNG = rngs ? rngs[i] : FastRNG(_rng.Next());
+		memcpy(slot->rngState, rowRNG.state, sizeof(slot->rngState));
+
+		slot->requestNs = GetNowNs();
+		slot->state.store(SLOT_REQUESTED, std::memory_order_release);
+	}
+
+	uint64_t deadlineNs = startNs + (uint64_t)_timeoutUs * 1000;
+	int numDone = 0, numSpins = 0;
+	while (numDone < batchSize) {
+		numDone = 0;
+		for (int i = 0; i < batchSize; i++) {
+			Slot* slot = _slots[i];
+			if (!slot) {
+				numDone++; // Already read
+				continue;
+			}
+
+			if (slot->state.load(std::memory_order_acquire) != SLOT_DONE)
+				continue;
+
+			_actions[i] = slot->action;
+			_logProbs[i] = slot->logProb;
+			memcpy(_rngs[i].state, slot->rngState, sizeof(slot->rngState));
+			slot->state.store(SLOT_FREE, std::memory_order_release);
+			_slots[i] = NULL;
+			numDone++;
+		}
+
+		if (numDone == batchSize)
+			break;
+
+		if (GetNowNs() >= deadlineNs) {
+			// Take back whatever the server hasn't answered
+			for (int i = 0; i < batchSize; i++) {
+				Slot* slot = _slots[i];
+				if (!slot)
+					continue;
+
+				uint32_t expected = SLOT_REQUESTED;
+				if (slot->state.compare_exchange_strong(expected, SLOT_FREE, std::memory_order_relaxed))
+					continue;
+
+				expected = SLOT_SERVING;
+				if (slot->state.compare_exchange_strong(expected, SLOT_ABANDONED, std::memory_order_relaxed))
+					continue; // The server frees it when it's done
+
+				// Finished in the meantime
+				slot->state.store(SLOT_FREE, std::memory_order_release);
+			}
+
+			_stats.numTimeouts++;
+			Disconnect("timed out");
+			return false;
+		}
+
+		if (++numSpins > WAIT_SPINS)
+			std::this_thread::yield();
+	}
+
+	for (int i = 0; i < batchSize; i++) {
+		outActions[i] = _actions[i];
+		if (outLogProbs && !deterministic)
+			outLogProbs[i] = _logProbs[i];
+		if (rngs)
+			rngs[i] = _rngs[i];
+	}
+
+	_stats.numRemoteCalls++;
+	_stats.numRemoteRows += batchSize;
+	if (_roundTripUs.size() < MAX_LATENCY_SAMPLES)
+		_roundTripUs.push_back((GetNowNs() - startNs) / 1000.f);
+	return true;
+}
+
+void GGL::RemoteInferenceBackend::InferLogits(const float* obs, int batchSize, float* outLogits) {
+	_local->InferLogits(obs, batchSize, outLogits);
+}
+
+void GGL::RemoteInferenceBackend::InferActions(
+	const float* obs, const uint8_t* actionMasks, int batchSize,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	if (InferRemote(obs, actionMasks, batchSize, deterministic, temperature, outActions, outLogProbs, rngs))
+		return;
+
+	_stats.numLocalCalls++;
+	_local->InferActions(obs, actionMasks, batchSize, deterministic, temperature, outActions, outLogProbs, rngs);
+}
+
+GGL::RemoteInferStats GGL::RemoteInferenceBackend::TakeStats() {
+	RemoteInferStats stats = _stats;
+	stats.roundTrip = MakeInferLatencyStats(_roundTripUs);
+
+	_stats = {};
+	_roundTripUs.clear();
+	return stats;
+}
+
+void GGL::RemoteInferenceBackend::LogStats(const RemoteInferStats& stats) {
+	RG_LOG(
+		"RemoteInferenceBackend: " << stats.numRemoteCalls << " calls (" << stats.numRemoteRows << " rows) served by \"" << _serverName << "\", " <<
+		stats.numLocalCalls << " ran locally (" << stats.numNoServer << " without a server, " << stats.numSlotsFull << " with no free slots, " <<
+		stats.numTimeouts << " timed out)"
+	);
+
+	if (stats.roundTrip.numSamples > 0) {
+		RG_LOG(
+			"RemoteInferenceBackend:  Round trip: mean " << stats.roundTrip.meanUs << "us, p50 " << stats.roundTrip.p50Us <<
+			"us, p90 " << stats.roundTrip.p90Us << "us, p99 " << stats.roundTrip.p99Us << "us, max " << stats.roundTrip.maxUs << "us"
+		);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <GigaLearnCPP/InferServer.h>
+
+namespace GGL {
+
+	struct RemoteInferStats {
+		uint64_t numRemoteCalls = 0, numRemoteRows = 0;
+		uint64_t numLocalCalls = 0;  // Calls that ran on the local backend, for any of the reasons below
+		uint64_t numNoServer = 0;    // No server running under the name (or it's stale, or runs a different model)
+		uint64_t numSlotsFull = 0;   // The server had no free slots for the whole batch
+		uint64_t numTimeouts = 0;
+
+		InferLatencyStats roundTrip; // Per remote call, first slot claimed -> last result read
+	};
+
+	// Sends InferActions() to an InferServer in another process, which batches it with other bots' decisions
+	// Whenever the server isn't there, has no room, runs a different model (see GetBackendFingerprint()) or doesn't answer within
+	// timeoutUs, the call runs on the local backend instead, so a bot never depends on the server being up
+	// InferLogits() always runs locally
+	class RemoteInferenceBackend : public InferenceBackend {
+	public:
+		RemoteInferenceBackend(const std::string& serverName, std::unique_ptr<InferenceBackend> localBackend, int timeoutUs);
+		~RemoteInferenceBackend(); // Logs the stats
+		RG_NO_COPY(RemoteInferenceBackend);
+
+		const char* GetName() const override { return "remote"; }
+		InferenceBackend& GetLocalBackend() { return *_local; }
+
+		std::vector<MemoryRegion> GetWeightRegions() const override { return _local->GetWeightRegions(); }
+		size_t MoveWeightsToHugePages() override { return _local->MoveWeightsToHugePages(); }
+		bool NeedsModels() const override { return _local->NeedsModels(); }
+		bool UsesIntraOpThreads() const override { return _local->UsesIntraOpThreads(); }
+
+		void InferLogits(const float* obs, int batchSize, float* outLogits) override;
+
+		void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) override;
+
+		bool IsConnected() const { return _header != NULL; }
+
+		// Returns the stats since the last call and resets them
+		RemoteInferStats TakeStats();
+		void LogStats(const RemoteInferStats& stats);
+
+	private:
+		std::unique_ptr<InferenceBackend> _local;
+		std::string _serverName;
+		uint64_t _fingerprint;
+		int _timeoutUs;
+
+		std::unique_ptr<SharedMemory> _memory;
+		InferShm::Header* _header = NULL;
+		uint64_t _nextConnectNs = 0;
+		bool _loggedMismatch = false;
+
+		// Rows sampled without a caller generator get one drawn from this
+		FastRNG _rng;
+
+		// Per call, results are only copied out once every row has one, so a failed call leaves the caller's rngs untouched
+		std::vector<InferShm::Slot*> _slots;
+		std::vector<int> _actions;
+		std::vector<float> _logProbs;
+		std::vector<FastRNG> _rngs;
+
+		RemoteInferStats _stats;
+		std::vector<float> _roundTripUs;
+
+		// Opens and validates the server's segment, at most once per reconnect interval
+		bool TryConnect(uint64_t nowNs);
+		void Disconnect(const char* reason);
+
+		// Returns false without touching the outputs if the call has to run locally
+		bool InferRemote(
+			const float* obs, const uint8_t* actionMasks, int batchSize, bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		);
+	};
+}
@@ -0,0 +1,39 @@
+#include "Sampler.h"
+
+int GGL::SampleMaskedLogits(const float* logits, const uint8_t* mask, int size, float temperature, FastRNG& rng, float* outLogProb) {
+	// Guard against bad temperature
+	if (!(temperature > 0.f)) temperature = 1.f;
+	float invTemp = 1 / temperature;
+
+	int best = -1;
+	for (int i = 0; i < size; i++)
+		if (mask[i] && (best == -1 || logits[i] > logits[best]))
+			best = i;
+
+	if (best == -1)
+		return -1;
+
+	float maxLogit = logits[best];
+	float total = 0;
+	for (int i = 0; i < size; i++)
+		if (mask[i])
+			total += expf((logits[i] - maxLogit) * invTemp);
+
+	// Rounding can leave a sliver of target at the end, which goes to the last enabled action
+	float target = rng.NextFloat() * total;
+	int action = best;
+	for (int i = 0; i < size; i++) {
+		if (!mask[i])
+			continue;
+
+		action = i;
+		target -= expf((logits[i] - maxLogit) * invTemp);
+		if (target < 0)
+			break;
+	}
+
+	if (outLogProb)
+		*outLogProb = (logits[action] - maxLogit) * invTemp - logf(total);
+
+	return action;
+}
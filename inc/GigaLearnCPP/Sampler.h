@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GigaLearnCPP/Framework.h>
+
+namespace GGL {
+
+	// xoroshiro128+, small and fast enough to give every bot its own stream
+	// Not cryptographic, but plenty for action sampling
+	struct FastRNG {
+		uint64_t state[2];
+
+		explicit FastRNG(uint64_t seed = 0) {
+			Seed(seed);
+		}
+
+		// State is expanded from the seed with splitmix64, so nearby seeds give unrelated streams
+		void Seed(uint64_t seed) {
+			for (uint64_t& s : state) {
+				uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				s = z ^ (z >> 31);
+			}
+		}
+
+		uint64_t Next() {
+			uint64_t s0 = state[0], s1 = state[1];
+			uint64_t result = s0 + s1;
+			s1 ^= s0;
+			state[0] = RotL(s0, 24) ^ s1 ^ (s1 << 16);
+			state[1] = RotL(s1, 37);
+			return result;
+		}
+
+		// Uniform in [0, 1)
+		float NextFloat() {
+			return (Next() >> 40) * (1.f / (1 << 24));
+		}
+
+	private:
+		static uint64_t RotL(uint64_t x, int k) {
+			return (x << k) | (x >> (64 - k));
+		}
+	};
+
+	// Samples from softmax(logits / temperature) over the enabled actions by inverting the CDF
+	// Nothing is allocated, exps are recomputed on the second pass instead of being stored
+	// Returns -1 if nothing is enabled, outLogProb (if set) gets the log-probability of the chosen action
+	int SampleMaskedLogits(const float* logits, const uint8_t* mask, int size, float temperature, FastRNG& rng, float* outLogProb = NULL);
+}
@@ -0,0 +1,217 @@
+#include "ShadowEvaluator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#ifndef GGL_NO_TORCH
+#include <GigaLearnCPP/FrameworkTorch.h>
+#endif
+
+namespace {
+	// Stops recording latencies past this, until the next TakeReport()
+	constexpr size_t MAX_LATENCY_SAMPLES = 1 << 20;
+
+	GGL::ShadowLatencyStats MakeLatencyStats(std::vector<float>& samples) {
+		GGL::ShadowLatencyStats stats = {};
+		stats.numCalls = (int)samples.size();
+		if (samples.empty())
+			return stats;
+
+		std::sort(samples.begin(), samples.end());
+
+		double total = 0;
+		for (float sample : samples)
+			total += sample;
+		stats.meanUs = total / samples.size();
+
+		// Nearest-rank
+		auto getPercentile = [&](double fraction) {
+			size_t index = (size_t)(fraction * (samples.size() - 1) + 0.5);
+			return (double)samples[index];
+		};
+		stats.p50Us = getPercentile(0.50);
+		stats.p90Us = getPercentile(0.90);
+		stats.p99Us = getPercentile(0.99);
+		stats.maxUs = samples.back();
+		return stats;
+	}
+}
+
+GGL::ShadowEvaluator::ShadowEvaluator(std::unique_ptr<InferenceBackend> backend, int maxBatchSize, int numSlots) :
+	obsSize(backend->obsSize), numActions(backend->numActions), _backend(std::move(backend)) {
+
+	RG_ASSERT(numSlots > 0);
+
+	_slots.resize(numSlots);
+	for (auto& slot : _slots) {
+		slot.obs.resize((size_t)maxBatchSize * obsSize);
+		slot.masks.resize((size_t)maxBatchSize * numActions);
+		slot.actions.resize(maxBatchSize);
+	}
+
+	_thread = std::thread(&ShadowEvaluator::Run, this);
+}
+
+GGL::ShadowEvaluator::~ShadowEvaluator() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_one();
+	_thread.join();
+}
+
+void GGL::ShadowEvaluator::Submit(
+	const float* obs, const uint8_t* actionMasks, int batchSize, bool deterministic, float temperature,
+	const int* actions, double primaryUs) {
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_tail - _head >= _slots.size()) {
+			_numDropped++;
+			return;
+		}
+
+		auto& slot = _slots[_tail % _slots.size()];
+		if (slot.actions.size() < (size_t)batchSize) {
+			slot.obs.resize((size_t)batchSize * obsSize);
+			slot.masks.resize((size_t)batchSize * numActions);
+			slot.actions.resize(batchSize);
+		}
+
+		std::copy(obs, obs + (size_t)batchSize * obsSize, slot.obs.begin());
+		std::copy(actionMasks, actionMasks + (size_t)batchSize * numActions, slot.masks.begin());
+		std::copy(actions, actions + batchSize, slot.actions.begin());
+		slot.batchSize = batchSize;
+		slot.deterministic = deterministic;
+		slot.temperature = temperature;
+		slot.primaryUs = primaryUs;
+		_tail++;
+	}
+	_cv.notify_one();
+}
+
+void GGL::ShadowEvaluator::Run() {
+#ifndef GGL_NO_TORCH
+	RG_NO_GRAD; // Grad mode is per-thread
+#endif
+
+	// Get the shadow's cold passes out of the way, so they don't show up in its latencies
+	{
+		std::vector<float> warmupObs(obsSize), warmupLogits(numActions);
+		_backend->Prefault();
+		for (int i = 0; i < 3; i++)
+			_backend->InferLogits(warmupObs.data(), 1, warmupLogits.data());
+	}
+
+	std::vector<int> shadowActions;
+
+	while (true) {
+		Slot* slot;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [&] { return _stop || _head != _tail; });
+			if (_stop)
+				break;
+
+			slot = &_slots[_head % _slots.size()];
+		}
+
+		if (shadowActions.size() < (size_t)slot->batchSize)
+			shadowActions.resize(slot->batchSize);
+
+		// Uses the backend's own generator when sampling, the live rngs belong to the bots
+		auto startTime = std::chrono::steady_clock::now();
+		_backend->InferActions(
+			slot->obs.data(), slot->masks.data(), slot->batchSize, slot->deterministic, slot->temperature,
+			shadowActions.data(), NULL, NULL
+		);
+		double shadowUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+
+		int numAgreed = 0;
+		if (slot->deterministic)
+			for (int i = 0; i < slot->batchSize; i++)
+				numAgreed += (shadowActions[i] == slot->actions[i]);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_numCalls++;
+			if (slot->deterministic) {
+				_numCompared += slot->batchSize;
+				_numAgreed += numAgreed;
+			}
+
+			if (_shadowUs.size() < MAX_LATENCY_SAMPLES) {
+				_primaryUs.push_back((float)slot->primaryUs);
+				_shadowUs.push_back((float)shadowUs);
+			}
+
+			_head++;
+		}
+	}
+}
+
+GGL::ShadowReport GGL::ShadowEvaluator::TakeReport() {
+	std::vector<float> primaryUs, shadowUs;
+
+	ShadowReport report = {};
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		report.numCalls = _numCalls;
+		report.numDropped = _numDropped;
+		report.numCompared = _numCompared;
+		report.numAgreed = _numAgreed;
+		_numCalls = _numDropped = _numCompared = _numAgreed = 0;
+
+		primaryUs.swap(_primaryUs);
+		shadowUs.swap(_shadowUs);
+	}
+
+	report.agreement = report.numCompared ? ((float)report.numAgreed / report.numCompared) : 0;
+	report.primary = MakeLatencyStats(primaryUs);
+	report.shadow = MakeLatencyStats(shadowUs);
+	return report;
+}
+
+void GGL::LogShadowReport(const ShadowReport& report, const char* primaryName, const char* shadowName) {
+	auto formatLatency = [](const ShadowLatencyStats& stats) {
+		std::stringstream stream;
+		stream <<
+			"mean " << stats.meanUs << "us, p50 " << stats.p50Us << "us, p90 " << stats.p90Us <<
+			"us, p99 " << stats.p99Us << "us, max " << stats.maxUs << "us";
+		return stream.str();
+	};
+
+	RG_LOG(
+		"ShadowEvaluator: " << shadowName << " vs " << primaryName << " over " << report.numCalls << " decisions (" <<
+		report.numDropped << " dropped): " << (report.agreement * 100) << "% action agreement on " << report.numCompared << " deterministic rows"
+	);
+	RG_LOG("ShadowEvaluator:  " << primaryName << " (live): " << formatLatency(report.primary));
+	RG_LOG("ShadowEvaluator:  " << shadowName << " (shadow): " << formatLatency(report.shadow));
+}
+
+void GGL::AppendShadowReportCSV(const std::filesystem::path& path, const ShadowReport& report, const char* primaryName, const char* shadowName) {
+	bool isNew = !std::filesystem::exists(path);
+
+	std::ofstream out(path, std::ios::app);
+	if (!out.good()) {
+		RG_LOG("ShadowEvaluator: Failed to open " << path << " for writing");
+		return;
+	}
+
+	if (isNew) {
+		out <<
+			"primary,shadow,decisions,dropped,compared,agreed,agreement,"
+			"primary_mean_us,primary_p50_us,primary_p90_us,primary_p99_us,primary_max_us,"
+			"shadow_mean_us,shadow_p50_us,shadow_p90_us,shadow_p99_us,shadow_max_us\n";
+	}
+
+	out <<
+		primaryName << "," << shadowName << "," << report.numCalls << "," << report.numDropped << "," <<
+		report.numCompared << "," << report.numAgreed << "," << report.agreement;
+	for (auto stats : { &report.primary, &report.shadow })
+		out << "," << stats->meanUs << "," << stats->p50Us << "," << stats->p90Us << "," << stats->p99Us << "," << stats->maxUs;
+	out << "\n";
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GigaLearnCPP/InferenceBackend.h>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace GGL {
+
+	// Latency distribution of one path, in microseconds per InferActions() call
+	struct ShadowLatencyStats {
+		int numCalls = 0;
+		double meanUs = 0, p50Us = 0, p90Us = 0, p99Us = 0, maxUs = 0;
+	};
+
+	struct ShadowReport {
+		uint64_t numCalls = 0;    // Decisions the shadow ran
+		uint64_t numDropped = 0;  // Decisions skipped because the shadow fell behind
+		uint64_t numCompared = 0; // Rows of deterministic decisions (sampled actions aren't comparable)
+		uint64_t numAgreed = 0;
+		float agreement = 0;      // numAgreed / numCompared
+
+		ShadowLatencyStats primary, shadow;
+	};
+
+	// Runs a candidate backend next to the live one without ever affecting the live actions
+	// Each decision copies its obs, masks and actions into a fixed ring of slots, which a background thread replays on the candidate
+	// If the ring is full the decision is left out of the comparison, so the live path never waits on the shadow
+	// NOTE: The shadow competes with the live path for cores, so its latencies are only representative with cores to spare
+	class ShadowEvaluator {
+	public:
+		int obsSize, numActions;
+
+		ShadowEvaluator(std::unique_ptr<InferenceBackend> backend, int maxBatchSize, int numSlots = 64);
+		~ShadowEvaluator();
+		RG_NO_COPY(ShadowEvaluator);
+
+		const char* GetBackendName() const { return _backend->GetName(); }
+		InferPrecision GetBackendPrecision() const { return _backend->precision; }
+
+		// Called on the decision thread right after the live backend's InferActions()
+		void Submit(
+			const float* obs, const uint8_t* actionMasks, int batchSize, bool deterministic, float temperature,
+			const int* actions, double primaryUs
+		);
+
+		// Returns the stats since the last call and resets them
+		ShadowReport TakeReport();
+
+	private:
+		struct Slot {
+			std::vector<float> obs;
+			std::vector<uint8_t> masks;
+			std::vector<int> actions;
+			int batchSize;
+			bool deterministic;
+			float temperature;
+			double primaryUs;
+		};
+
+		std::unique_ptr<InferenceBackend> _backend;
+		std::thread _thread;
+
+		// Guards everything below
+		std::mutex _mutex;
+		std::condition_variable _cv;
+		bool _stop = false;
+
+		// Slots in [_head, _tail) are queued, the worker owns _head until it advances it
+		std::vector<Slot> _slots;
+		uint64_t _head = 0, _tail = 0;
+
+		uint64_t _numCalls = 0, _numDropped = 0, _numCompared = 0, _numAgreed = 0;
+		std::vector<float> _primaryUs, _shadowUs;
+
+		void Run();
+	};
+
+	void LogShadowReport(const ShadowReport& report, const char* primaryName, const char* shadowName);
+
+	// Appends one CSV row per report, writing the column names first if the file is new
+	void AppendShadowReportCSV(const std::filesystem::path& path, const ShadowReport& report, const char* primaryName, const char* shadowName);
+}
@@ -0,0 +1,74 @@
+#include "TorchBackend.h"
+
+#include <GigaLearnCPP/Models.h>
+#include <GigaLearnCPP/InferenceModels.h>
+
+GGL::TorchInferenceBackend::TorchInferenceBackend(ModelSet& models, int obsSize, int numActions, bool useGPU, bool halfPrec) :
+	InferenceBackend(obsSize, numActions), models(models), useGPU(useGPU), halfPrec(halfPrec) {
+
+	if (halfPrec) {
+		precision = InferPrecision::BF16;
+
+		// Build the mirrors now rather than on the first decision
+		for (auto& pair : models.map)
+			pair.second->UpdateHalfMirror();
+	}
+}
+
+std::vector<GGL::MemoryRegion> GGL::TorchInferenceBackend::GetWeightRegions() const {
+	std::vector<MemoryRegion> regions;
+	for (auto& pair : models.map) {
+		auto model = pair.second;
+		for (auto& param : model->seq->parameters(true))
+			if (param.is_cpu())
+				regions.push_back({ param.data_ptr(), param.nbytes() });
+
+		if (halfPrec && model->seqHalf)
+			for (auto& param : model->seqHalf->parameters(true))
+				if (param.is_cpu())
+					regions.push_back({ param.data_ptr(), param.nbytes() });
+	}
+	return regions;
+}
+
+void GGL::TorchInferenceBackend::InferLogits(const float* obs, int batchSize, float* outLogits) {
+	RG_NO_GRAD;
+
+	auto device = useGPU ? torch::kCUDA : torch::kCPU;
+	auto tObs = PTR_TO_TENSOR_VIEW(obs, batchSize, obsSize).to(device);
+
+	auto logits = GGL::Infer::InferLogits(models, tObs, halfPrec).contiguous().cpu().to(torch::kFloat);
+	memcpy(outLogits, logits.data_ptr<float>(), (size_t)batchSize * numActions * sizeof(float));
+}
+
+void GGL::TorchInferenceBackend::InferActions(
+	const float* obs, const uint8_t* actionMasks, int batchSize,
+	bool deterministic, float temperature,
+	int* outActions, float* outLogProbs, FastRNG* rngs) {
+
+	RG_NO_GRAD;
+
+	auto device = useGPU ? torch::kCUDA : torch::kCPU;
+
+	// Views over the caller's buffers, no copies on CPU
+	auto tObs = PTR_TO_TENSOR_VIEW(obs, batchSize, obsSize).to(device);
+	auto tMasks = PTR_TO_TENSOR_VIEW(actionMasks, batchSize, numActions).to(device);
+
+	torch::Tensor tActions, tLogProbs;
+
+	GGL::Infer::InferActions(
+		models,
+		tObs,
+		tMasks,
+		deterministic,
+		temperature,
+		halfPrec,
+		&tActions,
+		(outLogProbs && !deterministic) ? &tLogProbs : NULL,
+		rngs
+	);
+
+	TENSOR_COPY_TO(tActions, outActions);
+	if (tLogProbs.defined())
+		TENSOR_COPY_TO(tLogProbs, outLogProbs);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "InferenceBackend.h"
+
+namespace GGL {
+
+	// The original libtorch path, kept for GPU inference and parity checks
+	class TorchInferenceBackend : public InferenceBackend {
+	public:
+		ModelSet& models; // not owned
+		bool useGPU;
+		bool halfPrec; // Runs through each model's bf16 mirror (Model::seqHalf)
+
+		TorchInferenceBackend(ModelSet& models, int obsSize, int numActions, bool useGPU, bool halfPrec = false);
+
+		virtual const char* GetName() const override { return "libtorch"; }
+
+		// Only CPU weights are host memory
+		virtual std::vector<MemoryRegion> GetWeightRegions() const override;
+
+		virtual bool UsesIntraOpThreads() const override { return !useGPU; }
+		virtual bool NeedsModels() const override { return true; }
+
+		virtual void InferLogits(const float* obs, int batchSize, float* outLogits) override;
+
+		virtual void InferActions(
+			const float* obs, const uint8_t* actionMasks, int batchSize,
+			bool deterministic, float temperature,
+			int* outActions, float* outLogProbs, FastRNG* rngs
+		) override;
+	};
+}
@@ -16,5 +16,13 @@ namespace RLGC {
 		virtual std::vector<uint8_t> GetActionMask(const Player& player, const GameState& state) {
 			return std::vector<uint8_t>(GetActionAmount(), true);
 		}
+
+		// Same as GetActionMask(), but writes into out (which has room for GetActionAmount() values)
+		// Override this to avoid allocating a new mask per call
+		virtual void GetActionMaskInto(const Player& player, const GameState& state, uint8_t* out) {
+			auto mask = GetActionMask(player, state);
+			RG_ASSERT((int)mask.size() == GetActionAmount());
+			memcpy(out, mask.data(), mask.size());
+		}
 	};
 }
\ No newline at end of file
@@ -90,6 +90,12 @@ RLGC::DefaultAction::DefaultAction() {
 
 std::vector<uint8_t> RLGC::DefaultAction::GetActionMask(const Player& player, const GameState& state) {
 	auto result = std::vector<uint8_t>(actions.size(), false);
+	GetActionMaskInto(player, state, result.data());
+	return result;
+}
+
+void RLGC::DefaultAction::GetActionMaskInto(const Player& player, const GameState& state, uint8_t* result) {
+	memset(result, false, actions.size());
 
 	auto fnApplyMask = [&](const std::vector<uint8_t>& mask, bool add) {
 		if (add) {
@@ -113,6 +119,4 @@ std::vector<uint8_t> RLGC::DefaultAction::GetActionMask(const Player& player, co
 	bool isTurtled = player.worldContact.hasContact && player.worldContact.contactNormal.z > 0.9f;
 	if (player.HasFlipOrJump() || isTurtled)
 		fnApplyMask(jumpMask, true);
-
-	return result;
 }
@@ -21,5 +21,6 @@ namespace RLGC {
 		}
 
 		virtual std::vector<uint8_t> GetActionMask(const Player& player, const GameState& state) override;
+		virtual void GetActionMaskInto(const Player& player, const GameState& state, uint8_t* out) override;
 	};
 }
\ No newline at end of file
@@ -23,8 +23,23 @@ void RLGC::AdvancedObs::AddPlayerToObs(FList& obs, const Player& player, bool in
 }
 
 RLGC::FList RLGC::AdvancedObs::BuildObs(const Player& player, const GameState& state) {
-	FList obs = {};
+	FList obs = {}, teammates = {}, opponents = {};
+	BuildObsLists(player, state, obs, teammates, opponents);
+	return obs;
+}
+
+int RLGC::AdvancedObs::BuildObsInto(const Player& player, const GameState& state, float* out, int capacity) {
+	// Reuse the member lists so their capacity sticks around between calls
+	_obs.clear();
+	_teammates.clear();
+	_opponents.clear();
+	BuildObsLists(player, state, _obs, _teammates, _opponents);
 
+	memcpy(out, _obs.data(), RS_MIN((int)_obs.size(), capacity) * sizeof(float));
+	return (int)_obs.size();
+}
+
+void RLGC::AdvancedObs::BuildObsLists(const Player& player, const GameState& state, FList& obs, FList& teammates, FList& opponents) {
 	bool inv = player.team == Team::ORANGE;
 
 	auto ball = InvertPhys(state.ball, inv);
@@ -49,7 +64,6 @@ RLGC::FList RLGC::AdvancedObs::BuildObs(const Player& player, const GameState& s
 	}
 
 	AddPlayerToObs(obs, player, inv, ball);
-	FList teammates = {}, opponents = {};
 
 	for (auto& otherPlayer : state.players) {
 		if (otherPlayer.carId == player.carId)
@@ -63,5 +77,4 @@ RLGC::FList RLGC::AdvancedObs::BuildObs(const Player& player, const GameState& s
 
 	obs += teammates;
 	obs += opponents;
-	return obs;
 }
\ No newline at end of file
@@ -15,5 +15,15 @@ namespace RLGC {
 		virtual void AddPlayerToObs(FList& obs, const Player& player, bool inv, const PhysState& ball);
 
 		virtual FList BuildObs(const Player& player, const GameState& state) override;
+		// NOTE: If you override BuildObs() in a subclass, override this as well (or it will still build the AdvancedObs layout)
+		virtual int BuildObsInto(const Player& player, const GameState& state, float* out, int capacity) override;
+
+	protected:
+		// Appends to obs, using teammates/opponents as scratch lists
+		void BuildObsLists(const Player& player, const GameState& state, FList& obs, FList& teammates, FList& opponents);
+
+	private:
+		// Scratch lists for BuildObsInto()
+		FList _obs, _teammates, _opponents;
 	};
 }
\ No newline at end of file
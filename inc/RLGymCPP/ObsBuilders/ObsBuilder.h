@@ -11,5 +11,14 @@ namespace RLGC {
 
 		// NOTE: May be called once during environment initialization to determine policy neuron size
 		virtual FList BuildObs(const Player& player, const GameState& state) = 0;
+
+		// Writes the obs straight into out, which has room for capacity floats
+		// Returns the obs size, if that is larger than capacity the obs was truncated
+		// Override this to avoid allocating a new FList per call
+		virtual int BuildObsInto(const Player& player, const GameState& state, float* out, int capacity) {
+			FList obs = BuildObs(player, state);
+			memcpy(out, obs.data(), RS_MIN((int)obs.size(), capacity) * sizeof(float));
+			return (int)obs.size();
+		}
 	};
 }
\ No newline at end of file
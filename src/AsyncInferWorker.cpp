@@ -0,0 +1,43 @@
+#include "AsyncInferWorker.h"
+
+AsyncInferWorker::AsyncInferWorker(std::shared_ptr<GGL::InferUnit> inferUnit)
+    : m_inferUnit(std::move(inferUnit))
+{
+    m_thread = std::thread(&AsyncInferWorker::Run, this);
+}
+
+AsyncInferWorker::~AsyncInferWorker() {
+    m_stop = true;
+    m_requests.Publish(); // Wakes the worker, which checks m_stop before looking at the request
+    m_thread.join();
+}
+
+void AsyncInferWorker::Run() {
+    uint64_t lastId = 0;
+
+    while (true) {
+        m_requests.WaitForValue();
+        if (m_stop)
+            break;
+
+        auto request = m_requests.TakeLatest();
+        if (!request)
+            continue;
+
+        if (lastId != 0 && request->id > lastId + 1)
+            m_numSkipped += request->id - lastId - 1;
+        lastId = request->id;
+
+        auto& result = m_results.GetWriteSlot();
+        result.id = request->id;
+        result.indices = request->indices;
+        result.actions.resize(request->indices.size());
+
+        m_inferUnit->BatchInferActions(
+            request->state, request->indices, request->deterministic, request->temperature,
+            request->rngs.data(), result.actions.data()
+        );
+
+        m_results.Publish();
+    }
+}
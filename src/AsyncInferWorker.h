@@ -0,0 +1,57 @@
+#pragma once
+
+#include "LatestMailbox.h"
+
+#include <GigaLearnCPP/InferUnit.h>
+#include <RLGymCPP/GameStates/GameState.h>
+
+#include <thread>
+
+struct AsyncDecisionRequest {
+    uint64_t id = 0;
+    RLGC::GameState state;
+    std::vector<int> indices; // Players to decide for
+    std::vector<GGL::FastRNG> rngs; // For this request only, nothing is handed back
+    bool deterministic = true;
+    float temperature = 1;
+};
+
+struct AsyncDecisionResult {
+    uint64_t id = 0; // Of the request
+    std::vector<int> indices;
+    std::vector<RLGC::Action> actions;
+};
+
+// Runs decisions on its own thread, so the packet callback never waits on the model
+// Both directions go through latest-value mailboxes: if the worker is still busy when a newer request comes in,
+// the older one is skipped, and a result the bot hasn't picked up yet is replaced by a newer one
+class AsyncInferWorker {
+public:
+    explicit AsyncInferWorker(std::shared_ptr<GGL::InferUnit> inferUnit);
+    ~AsyncInferWorker();
+
+    AsyncInferWorker(const AsyncInferWorker&) = delete;
+    AsyncInferWorker& operator=(const AsyncInferWorker&) = delete;
+
+    // Fill the returned request, then Submit() it
+    AsyncDecisionRequest& BeginRequest() { return m_requests.GetWriteSlot(); }
+    void Submit() { m_requests.Publish(); }
+
+    // The newest finished decision, or NULL if there is none since the last call
+    const AsyncDecisionResult* TakeResult() { return m_results.TakeLatest(); }
+
+    // Requests replaced by a newer one before the worker got to them
+    uint64_t GetNumSkipped() const { return m_numSkipped; }
+
+private:
+    std::shared_ptr<GGL::InferUnit> m_inferUnit;
+
+    LatestMailbox<AsyncDecisionRequest> m_requests;
+    LatestMailbox<AsyncDecisionResult> m_results;
+
+    std::atomic<bool> m_stop = false;
+    std::atomic<uint64_t> m_numSkipped = 0;
+    std::thread m_thread;
+
+    void Run();
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single-producer single-consumer mailbox that only keeps the newest value (a triple buffer)
+// Neither side ever blocks the other: the writer overwrites whatever the reader hasn't taken yet,
+// and the slots are reused, so values that keep their buffers (e.g. vectors) stop allocating once they've grown
+template <typename T>
+class LatestMailbox {
+public:
+    // Writer: fill the slot returned here, then Publish() it
+    T& GetWriteSlot() { return m_slots[m_writeIndex]; }
+
+    void Publish() {
+        uint32_t prev = m_shared.exchange(m_writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+        m_writeIndex = prev & INDEX_MASK;
+        m_shared.notify_one();
+    }
+
+    // Reader: the newest published value, or NULL if nothing was published since the last call
+    // The returned slot stays valid until the next call
+    T* TakeLatest() {
+        if (!(m_shared.load(std::memory_order_relaxed) & FRESH_BIT))
+            return nullptr;
+
+        uint32_t prev = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = prev & INDEX_MASK;
+        return &m_slots[m_readIndex];
+    }
+
+    // Reader: blocks until a value is published (may also return spuriously)
+    void WaitForValue() {
+        uint32_t cur = m_shared.load(std::memory_order_relaxed);
+        if (!(cur & FRESH_BIT))
+            m_shared.wait(cur, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t FRESH_BIT = 4, INDEX_MASK = 3;
+
+    T m_slots[3] = {};
+
+    // Each side owns one slot, the third is shared and handed over through m_shared
+    uint32_t m_writeIndex = 0, m_readIndex = 1;
+    std::atomic<uint32_t> m_shared = 2;
+};
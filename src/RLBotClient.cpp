@@ -1,5 +1,7 @@
 #include "RLBotClient.h"
 
+#include <random>
+
 using namespace RLGC;
 
 namespace
@@ -8,8 +10,7 @@ namespace
         return Vec(rlbotVec.x(), rlbotVec.y(), rlbotVec.z());
     }
 
-    PhysState ToPhysObj(const rlbot::flat::Physics* phys) {
-        PhysState obj = {};
+    void ToPhysObj(const rlbot::flat::Physics* phys, PhysState& obj) {
         obj.pos = ToVec(phys->location());
 
         Angle ang = Angle(phys->rotation().yaw(), phys->rotation().pitch(), phys->rotation().roll());
@@ -17,14 +18,38 @@ namespace
 
         obj.vel = ToVec(phys->velocity());
         obj.angVel = ToVec(phys->angular_velocity());
-        return obj;
     }
 
-    Player ToPlayer(const rlbot::flat::PlayerInfo* playerInfo, float dtSec, PlayerTimingState& timing)
-    {
-        Player pd = {};
+    // Runs on every packet, the airtime timers accumulate frame deltas even when no GameState is built
+    void UpdatePlayerTiming(rlbot::flat::GamePacket const* packet, float dtSec, std::vector<PlayerTimingState>& playerTiming) {
+        auto players = packet->players();
+        if (!players)
+            return;
+
+        const int n = (int)players->size();
+        if ((int)playerTiming.size() < n)
+            playerTiming.resize(n);
+
+        for (int i = 0; i < n; i++) {
+            auto playerInfo = players->Get(i);
+            auto& timing = playerTiming[i];
+
+            // Approximate airtime timers (used for HasFlipOrJump behavior)
+            if (playerInfo->air_state() == rlbot::flat::AirState::OnGround) {
+                timing.airTime = 0.f;
+                timing.airTimeSinceJump = 0.f;
+            }
+            else {
+                timing.airTime += dtSec;
+
+                timing.airTimeSinceJump = playerInfo->has_jumped() ? timing.airTime : 0.f;
+            }
+        }
+    }
 
-        static_cast<PhysState&>(pd) = ToPhysObj(playerInfo->physics());
+    void ToPlayer(const rlbot::flat::PlayerInfo* playerInfo, const PlayerTimingState& timing, Player& pd)
+    {
+        ToPhysObj(playerInfo->physics(), pd);
 
         pd.carId = playerInfo->player_id();
         pd.team = (Team)playerInfo->team();
@@ -37,51 +62,41 @@ namespace
         pd.hasFlipped = playerInfo->has_dodged();
         pd.isDemoed = playerInfo->demolished_timeout() >= 0.f;
 
-        // Approximate airtime timers (used for HasFlipOrJump behavior)
-        if (pd.isOnGround) {
-            timing.airTime = 0.f;
-            timing.airTimeSinceJump = 0.f;
-        }
-        else {
-            timing.airTime += dtSec;
-
-            timing.airTimeSinceJump = pd.hasJumped ? timing.airTime : 0.f;
-        }
-
         pd.airTime = timing.airTime;
         pd.airTimeSinceJump = timing.airTimeSinceJump;
-
-        return pd;
     }
 
-    GameState ToGameState(rlbot::flat::GamePacket const* packet, float dtSec, std::vector<PlayerTimingState>& playerTiming) {
-        GameState gs = {};
-
+    // Refreshes gs in place, so its player and boost pad buffers are reused between decisions
+    // Expects UpdatePlayerTiming() to have run on this packet
+    void UpdateGameState(rlbot::flat::GamePacket const* packet, const std::vector<PlayerTimingState>& playerTiming, GameState& gs) {
         auto players = packet->players();
-        if (players) {
-            const int n = (int)players->size();
-            if ((int)playerTiming.size() < n)
-                playerTiming.resize(n);
-
-            gs.players.reserve(n);
-            for (int i = 0; i < n; i++) {
-                gs.players.push_back(ToPlayer(players->Get(i), dtSec, playerTiming[i]));
-            }
+        const int n = players ? (int)players->size() : 0;
+
+        if ((int)gs.players.size() != n) {
+            // Cars joined or left, start the players over so no stale fields carry into another car's slot
+            gs.players.clear();
+            gs.players.resize(n);
         }
 
-        static_cast<PhysState&>(gs.ball) = ToPhysObj(packet->balls()->Get(0)->physics());
+        for (int i = 0; i < n; i++)
+            ToPlayer(players->Get(i), playerTiming[i], gs.players[i]);
+
+        ToPhysObj(packet->balls()->Get(0)->physics(), gs.ball);
 
         auto boostPadStates = packet->boost_pads();
         if (boostPadStates->size() != CommonValues::BOOST_LOCATIONS_AMOUNT) {
             if (rand() % 20 == 0) { // Don't spam-log as that will lag the bot
                 RG_LOG(
-                    "RLBotClient ToGameState(): Bad boost pad amount, expected "
+                    "RLBotClient UpdateGameState(): Bad boost pad amount, expected "
                     << CommonValues::BOOST_LOCATIONS_AMOUNT << " but got " << boostPadStates->size()
                 );
             }
 
             // Just set all boost pads to on
             std::fill(gs.boostPads.begin(), gs.boostPads.end(), 1);
+            std::fill(gs.boostPadsInv.begin(), gs.boostPadsInv.end(), 1);
+            std::fill(gs.boostPadTimers.begin(), gs.boostPadTimers.end(), 0.f);
+            std::fill(gs.boostPadTimersInv.begin(), gs.boostPadTimersInv.end(), 0.f);
         }
         else {
             for (int i = 0; i < CommonValues::BOOST_LOCATIONS_AMOUNT; i++) {
@@ -92,8 +107,6 @@ namespace
                 gs.boostPadTimersInv[CommonValues::BOOST_LOCATIONS_AMOUNT - i - 1] = gs.boostPadTimers[i];
             }
         }
-
-        return gs;
     }
 } // anonymous namespace
 
@@ -103,7 +116,11 @@ RLBotBot::RLBotBot(std::unordered_set<unsigned> indices_,
     std::shared_ptr<const SharedBotContext> ctx) noexcept
     : rlbot::Bot(std::move(indices_), team_, std::move(name_))
     , ctx_(std::move(ctx))
+    , m_scheduler(ctx_->params.tickSkip, ctx_->params.actionDelay)
 {
+    if (ctx_->params.asyncInference)
+        m_asyncWorker = std::make_unique<AsyncInferWorker>(ctx_->inferUnit);
+
     std::set<unsigned> sorted(std::begin(indices), std::end(indices));
     for (auto const& index : sorted)
         std::printf("Team %u Index %u: %s created\n", team_, index, name_.c_str());
@@ -118,15 +135,28 @@ void RLBotBot::update(rlbot::flat::GamePacket const* packet,
         return;
     }
 
-    float curTime = packet->match_info()->seconds_elapsed();
-    float deltaTime = curTime - prevTime;
-    prevTime = curTime;
+    // Shadow stats and decision timing are reported per match
+    bool matchEnded = (packet->match_info()->match_phase() == rlbot::flat::MatchPhase::Ended);
+    if (matchEnded && !matchWasEnded) {
+        ctx_->inferUnit->DumpShadowReport();
+
+        auto& stats = m_scheduler.GetStats();
+        RG_LOG(
+            "RLBotBot: Decision timing so far: " << stats.numDecisions << " decisions over " << stats.numPackets << " packets, " <<
+            stats.numMissed << " missed their deadline, " << stats.numLateDecisions << " started late, " <<
+            stats.numSkippedFrames << " frames without a packet, " << stats.numResyncs << " resyncs, worst apply lag " << stats.maxApplyLagFrames << " frames"
+        );
+        if (m_asyncWorker)
+            RG_LOG("RLBotBot: Async inference skipped " << m_asyncWorker->GetNumSkipped() << " requests for a newer one");
+    }
+    matchWasEnded = matchEnded;
+
+    uint32_t frame = packet->match_info()->frame_num();
+    TickPlan plan = m_scheduler.OnPacket(frame);
+    float deltaTime = plan.framesElapsed / 120.f;
 
-    int ticksElapsed = roundf(deltaTime * 120);
-    ticks += ticksElapsed;
+    UpdatePlayerTiming(packet, deltaTime, m_playerTiming);
 
-    GameState gs = ToGameState(packet, deltaTime, m_playerTiming);
-    
     for (auto const& index : this->indices)
     {
         auto& st = m_botState[index];
@@ -135,21 +165,77 @@ void RLBotBot::update(rlbot::flat::GamePacket const* packet,
 
             st.action = RLGC::Action{};
             st.controls = RLGC::Action{};
-        }
 
-        auto& localPlayer = gs.players[index];
-        localPlayer.prevAction = st.controls;
+            uint64_t seed = ctx_->params.seed ? (ctx_->params.seed + index) : std::random_device{}();
+            st.rng.Seed(seed);
+        }
+    }
 
-        if (updateAction) {
-            st.action = ctx_->inferUnit->InferAction(localPlayer, gs, true);
+    if (m_asyncWorker) {
+        if (auto result = m_asyncWorker->TakeResult(); result && result->id > m_committedId) {
+            for (size_t i = 0; i < result->indices.size(); i++) {
+                auto& st = m_botState[result->indices[i]];
+                st.action = result->actions[i];
+            }
+            m_committedId = result->id;
+            m_scheduler.MarkReady(result->id);
         }
+    }
+
+    // Due actions go out before the next decision replaces them, and before its obs are built from the controls
+    ApplyDueActions(frame);
+
+    if (plan.decide) {
+        // The full conversion is only needed when there's something to decide on
+        UpdateGameState(packet, m_playerTiming, m_gameState);
 
-        if (ticks >= (ctx_->params.actionDelay) || ticks == -1) {
-            // Apply new action
-            st.controls = st.action;
+        // Every car's prevAction has to be set before any obs is built, since the obs include teammates
+        for (auto const& index : this->indices)
+            m_gameState.players[index].prevAction = m_botState[index].controls;
+    }
+
+    if (plan.decide && m_asyncWorker) {
+        // The worker decides on its own thread, the result is committed by a later packet
+        auto& request = m_asyncWorker->BeginRequest();
+        request.id = m_scheduler.GetDecisionId();
+        request.state = m_gameState;
+        request.indices.assign(this->indices.begin(), this->indices.end());
+        // Every request gets its own streams split off the bots' generators, so requests that overlap (or are skipped)
+        // never sample with the same numbers, and a fixed seed gives the same streams for the same decisions
+        request.rngs.resize(request.indices.size());
+        for (size_t i = 0; i < request.indices.size(); i++)
+            request.rngs[i].Seed(m_botState[request.indices[i]].rng.Next());
+        request.deterministic = ctx_->params.deterministic;
+        request.temperature = ctx_->params.temperature;
+        m_asyncWorker->Submit();
+    } else if (plan.decide) {
+        // One batched call for all of our cars (e.g. a 3-car hivemind), instead of one forward pass per car
+        m_decisionIndices.assign(this->indices.begin(), this->indices.end());
+        m_decisionRNGs.resize(m_decisionIndices.size());
+        m_decisionActions.resize(m_decisionIndices.size());
+
+        for (size_t i = 0; i < m_decisionIndices.size(); i++)
+            m_decisionRNGs[i] = m_botState[m_decisionIndices[i]].rng;
+
+        ctx_->inferUnit->BatchInferActions(
+            m_gameState, m_decisionIndices, ctx_->params.deterministic, ctx_->params.temperature,
+            m_decisionRNGs.data(), m_decisionActions.data()
+        );
+
+        for (size_t i = 0; i < m_decisionIndices.size(); i++) {
+            auto& st = m_botState[m_decisionIndices[i]];
+            st.action = m_decisionActions[i];
+            st.rng = m_decisionRNGs[i];
         }
+        m_scheduler.MarkReady(m_scheduler.GetDecisionId());
+    }
 
-        const auto& c = st.controls;
+    // Without an action delay (and on the first decision), a synchronous decision is due right away
+    ApplyDueActions(frame);
+
+    for (auto const& index : this->indices)
+    {
+        const auto& c = m_botState[index].controls;
         setOutput(index, {
             c.throttle,
             c.steer,
@@ -162,14 +248,17 @@ void RLBotBot::update(rlbot::flat::GamePacket const* packet,
             false,
             });
     }
+}
 
-    if (updateAction) {
-        updateAction = false;
-    }
+void RLBotBot::ApplyDueActions(uint32_t frame)
+{
+    // Either the action is due, or it missed its deadline and goes out as soon as it's ready
+    // Until then the previous controls are reused
+    if (!m_scheduler.TakeApply(frame))
+        return;
 
-    if (ticks >= ctx_->params.tickSkip || ticks == -1) {
-        // Trigger action update next tick
-        ticks = 0;
-        updateAction = true;
+    for (auto const& index : this->indices) {
+        auto& st = m_botState[index];
+        st.controls = st.action;
     }
 }
@@ -5,11 +5,26 @@
 #include <RLGymCPP/ActionParsers/DefaultAction.h>
 #include <GigaLearnCPP/InferUnit.h>
 
+#include "AsyncInferWorker.h"
+#include "TickScheduler.h"
+
 namespace GGL { class InferUnit; }
 
 struct RLBotParams {
     int tickSkip;
     int actionDelay;
+
+    // Stochastic mode samples from the policy instead of taking the best action
+    bool deterministic = true;
+    float temperature = 1.f;
+
+    // Each bot index gets its own sampling stream derived from this, 0 picks a random seed per bot
+    uint64_t seed = 0;
+
+    // Run inference on a separate thread (see AsyncInferWorker), the packet callback never waits on the model
+    // The action isn't due until actionDelay ticks after the decision anyway, which is the time inference gets
+    // Results that miss that deadline are applied as soon as they arrive, and counted (see TickScheduler)
+    bool asyncInference = false;
 };
 
 struct SharedBotContext {
@@ -34,13 +49,14 @@ public:
         RLGC::Action
             action = {},
             controls = {};
+
+        // Used when sampling (non-deterministic), async requests get streams seeded from it instead
+        GGL::FastRNG rng;
     };
     
 
     // Persistent info
-    bool updateAction = true;
-    int ticks = -1;
-    float prevTime = 0;
+    bool matchWasEnded = false;
 
     RLBotBot() noexcept = delete;
     ~RLBotBot() noexcept override;
@@ -57,4 +73,20 @@ private:
     std::shared_ptr<const SharedBotContext> ctx_;
     std::unordered_map<unsigned, PerBotState> m_botState;
     std::vector<PlayerTimingState> m_playerTiming;
+
+    // Refreshed in place on decision ticks only
+    RLGC::GameState m_gameState;
+
+    // Every car this bot controls is inferred in one batch (see hivemind in bot.toml), these are reused between decisions
+    std::vector<int> m_decisionIndices;
+    std::vector<GGL::FastRNG> m_decisionRNGs;
+    std::vector<RLGC::Action> m_decisionActions;
+
+    // Decides when to infer and when actions are due, from the packet frame numbers
+    TickScheduler m_scheduler;
+
+    std::unique_ptr<AsyncInferWorker> m_asyncWorker;
+    uint64_t m_committedId = 0; // Newest async decision whose result was taken
+
+    void ApplyDueActions(uint32_t frame);
 };
@@ -1,6 +1,8 @@
 #include "RLBotClient.h"
 
 #include <rlbot/BotManager.h>
+#include <GigaLearnCPP/CompiledBackend.h>
+#include <GigaLearnCPP/InferServer.h>
 
 #include <filesystem>
 #include <fstream>
@@ -22,13 +24,8 @@ namespace
     }
     inline void trim(std::string& s) { ltrim(s); rtrim(s); }
 
-    inline bool starts_with(const std::string& s, const char* prefix) {
-        const size_t n = std::char_traits<char>::length(prefix);
-        return s.size() >= n && s.compare(0, n, prefix) == 0;
-    }
-
-    // Reads [settings] agent_id = "..." from bot.toml
-    std::optional<std::string> ReadAgentIdFromBotToml(const std::filesystem::path& botTomlPath)
+    // Reads [settings] key = value from bot.toml, quotes are stripped from string values
+    std::optional<std::string> ReadSettingFromBotToml(const std::filesystem::path& botTomlPath, const char* key)
     {
         std::ifstream f(botTomlPath);
         if (!f.is_open())
@@ -53,25 +50,27 @@ namespace
 
             if (!inSettings) continue;
 
-            // Look for agent_id = "..."
-            // Check key at start after trimming.
-            if (starts_with(line, "agent_id")) {
-                auto eq = line.find('=');
-                if (eq == std::string::npos) continue;
+            // Look for key = ...
+            auto eq = line.find('=');
+            if (eq == std::string::npos) continue;
 
-                std::string rhs = line.substr(eq + 1);
-                trim(rhs);
+            std::string lhs = line.substr(0, eq);
+            trim(lhs);
+            if (lhs != key) continue;
 
-                if (rhs.empty()) continue;
+            std::string rhs = line.substr(eq + 1);
+            trim(rhs);
 
-                char quote = rhs.front();
-                if (quote != '"' && quote != '\'') continue;
+            if (rhs.empty()) continue;
 
-                auto endq = rhs.find(quote, 1);
-                if (endq == std::string::npos) continue;
+            char quote = rhs.front();
+            if (quote != '"' && quote != '\'')
+                return rhs; // Bare value, e.g. true/false
 
-                return rhs.substr(1, endq - 1);
-            }
+            auto endq = rhs.find(quote, 1);
+            if (endq == std::string::npos) continue;
+
+            return rhs.substr(1, endq - 1);
         }
 
         return std::nullopt;
@@ -123,6 +122,11 @@ int main(int argc, char** argv)
     ctx->params.tickSkip = 8;
     ctx->params.actionDelay = ctx->params.tickSkip - 1;
 
+    ctx->params.deterministic = true; // Set to false to sample actions (with the temperature below) for more varied play
+    ctx->params.temperature = 1.f;
+    ctx->params.seed = 0; // Non-zero makes sampling reproducible per bot index
+    ctx->params.asyncInference = false; // Infers on a worker thread within the action delay, so the packet loop never waits
+
     int obsSize = 109; // You can find this from the console when running training
 
     // Shared head config
@@ -139,6 +143,28 @@ int main(int argc, char** argv)
     policyCfg.activationType = GGL::ModelActivationType::RELU;
     policyCfg.addOutputLayer = true;
 
+    // Inference options
+    GGL::InferUnitConfig inferCfg;
+    inferCfg.backend = GGL::InferBackendType::NATIVE; // Also TORCH, TORCH_JIT, TORCH_ONEDNN or NATIVE_INT8 (see InferBackendType)
+    inferCfg.precision = GGL::InferPrecision::AUTO; // bf16 on CPUs with AVX512-BF16/AMX, FP32 forces full precision
+    inferCfg.intraOpThreads = 0; // libtorch backends only: 0 autotunes per batch size at startup, >0 pins a thread count
+    inferCfg.checkParity = false; // Logs the logit difference between the chosen backend and libtorch at startup
+    inferCfg.profileLayers = false; // TORCH backend only: logs per-layer latency and GFLOP/s when the bot shuts down
+    // inferCfg.recordObsPath = "recorded_obs.bin"; // Records real matches, which NATIVE_INT8 can then calibrate on
+    // inferCfg.int8CalibrationPath = "recorded_obs.bin";
+    inferCfg.leanMemory = false; // Frees the torch copy of the models once a non-TORCH backend is built
+    // inferCfg.memoryReportIntervalSeconds = 60; // Logs RSS/peak RSS periodically
+    inferCfg.watchModels = false; // Reloads the models in the background whenever their files change
+    inferCfg.shadowEnabled = false; // Replays every decision on inferCfg.shadowBackend and logs agreement/latency at match end
+    // inferCfg.shadowBackend = GGL::InferBackendType::NATIVE_INT8;
+    // inferCfg.shadowReportPath = "shadow_report.csv";
+    // inferCfg.inferServerName = "GGLBot"; // Batches decisions with other GGLBot processes through "GGLBot --infer-server GGLBot"
+
+    // Inference server mode (see README), started with --infer-server [name]
+    GGL::InferServerConfig serverCfg;
+    serverCfg.batchWindowUs = 150; // How long a batch waits for other bots' requests, check the logged stats when tuning it
+    serverCfg.statsIntervalSeconds = 30;
+
     // ------------------------------------------
     // Everything below can usually be left as is
     // ------------------------------------------
@@ -151,6 +177,32 @@ int main(int argc, char** argv)
         exeDir = p.parent_path();
     }
 
+    bool runInferServer = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--infer-server") {
+            runInferServer = true;
+            if (i + 1 < argc)
+                serverCfg.name = argv[++i];
+        }
+    }
+
+    if (runInferServer) {
+        // The server owns the models, and serves them as they were loaded
+        inferCfg.inferServerName.clear();
+        inferCfg.watchModels = false;
+        inferCfg.shadowEnabled = false;
+    }
+
+#ifdef GGL_COMPILED_MODEL_HEADER
+    // Built with GGLBOT_COMPILED_MODEL: the network is baked into the exe, so no model files or libtorch are needed
+    ctx->inferUnit = std::make_shared<GGL::InferUnit>(
+        ctx->obs.get(),
+        obsSize,
+        ctx->act.get(),
+        std::make_unique<GGL::CompiledInferenceBackend>(obsSize, ctx->act->GetActionAmount()),
+        inferCfg
+    );
+#else
     bool useGPU = false;
 
     ctx->inferUnit = std::make_shared<GGL::InferUnit>(
@@ -160,9 +212,28 @@ int main(int argc, char** argv)
         sharedHeadCfg,
         policyCfg,
         exeDir, // Put model files next to exe
-        useGPU
+        useGPU,
+        inferCfg
     );
 
+    // Extra policies can be picked per player, e.g. a kickoff specialist loaded from its own folder:
+    // int kickoffPolicy = ctx->inferUnit->AddPolicy("kickoff", exeDir / "kickoff", sharedHeadCfg, policyCfg);
+    // ctx->inferUnit->SetPolicyRouter([=](const RLGC::Player& player, const RLGC::GameState& state) {
+    //     bool isKickoff = (state.ball.pos.x == 0 && state.ball.pos.y == 0 && state.ball.vel.LengthSq() == 0);
+    //     return isKickoff ? kickoffPolicy : 0;
+    // });
+#endif
+
+    // Pay for lazy init, page faults and buffer growth now, instead of on the first kickoff
+    ctx->inferUnit->Warmup();
+
+    if (runInferServer) {
+        GGL::InferServer server(*ctx->inferUnit->backend, serverCfg);
+        std::atomic<bool> stop = false;
+        server.Run(stop); // Until the process is closed
+        return 0;
+    }
+
     SetSpawnContext(ctx);
 
     auto const serverHost = []() -> char const* {
@@ -178,11 +249,21 @@ int main(int argc, char** argv)
     // Read agent_id from bot.toml next to the exe
     const std::filesystem::path botTomlPath = exeDir / "bot.toml";
     std::string agentIdStr = "GigaLearn/GGLBot"; // fallback default
-    if (auto maybeId = ReadAgentIdFromBotToml(botTomlPath)) {
+    if (auto maybeId = ReadSettingFromBotToml(botTomlPath, "agent_id")) {
         agentIdStr = *maybeId;
     }
 
-    RLBotBotManager manager(false);
+    // With hivemind = true, RLBot runs every car of the team in this one process
+    // They are then all handled by one RLBotBot, which infers them together in a single batch
+    bool batchHivemind = false;
+    if (auto maybeHivemind = ReadSettingFromBotToml(botTomlPath, "hivemind")) {
+        batchHivemind = (*maybeHivemind == "true");
+    }
+
+    if (batchHivemind)
+        RG_LOG("Hivemind enabled, all cars of this process are inferred as one batch");
+
+    RLBotBotManager manager(batchHivemind);
 
     if (!manager.connect(serverHost, serverPort, agentIdStr.c_str(), false)) {
         return EXIT_FAILURE;
@@ -0,0 +1,106 @@
+#include "TickScheduler.h"
+
+#include <algorithm>
+
+TickScheduler::TickScheduler(int tickSkip, int actionDelay)
+    : m_tickSkip(std::max(tickSkip, 1))
+{
+    // A decision's action has to be due before the next decision starts, so older decisions are always past their deadline
+    m_actionDelay = std::clamp(actionDelay, 0, m_tickSkip - 1);
+}
+
+TickPlan TickScheduler::OnPacket(uint32_t frame) {
+    TickPlan plan = {};
+
+    bool restarted = false;
+    if (!m_started || frame < m_lastFrame) {
+        // First packet, or the frame counter restarted (e.g. a new match)
+        if (m_started)
+            m_stats.numResyncs++;
+
+        m_started = true;
+        m_nextDecisionFrame = frame;
+        restarted = true;
+    } else if (frame == m_lastFrame) {
+        return plan; // Same frame again, nothing new to decide on
+    } else {
+        plan.framesElapsed = frame - m_lastFrame;
+        m_stats.numSkippedFrames += plan.framesElapsed - 1;
+    }
+
+    m_lastFrame = frame;
+    m_stats.numPackets++;
+
+    if (frame >= m_nextDecisionFrame) {
+        uint32_t scheduledFrame = m_nextDecisionFrame;
+        if (frame - scheduledFrame >= (uint32_t)m_tickSkip) {
+            // A whole decision period went by without packets (a pause or a lag spike), start the grid over from here
+            scheduledFrame = frame;
+            m_stats.numResyncs++;
+        } else if (frame > scheduledFrame) {
+            m_stats.numLateDecisions++;
+        }
+
+        // The previous decision's deadline is behind us, if it isn't ready by now it missed it
+        if (m_readyId < m_decisionId)
+            RecordMiss(m_decisionId);
+
+        plan.decide = true;
+        m_decisionId++;
+        m_stats.numDecisions++;
+        m_prevDeadlineFrame = m_deadlineFrame;
+        m_nextDecisionFrame = scheduledFrame + m_tickSkip;
+
+        if (restarted) {
+            // There are no controls to keep before the first decision, so its action goes out as soon as it's ready
+            // It has nothing to be late for, so it's never counted as a miss
+            m_deadlineFrame = scheduledFrame;
+            m_lastMissId = m_decisionId;
+        } else {
+            m_deadlineFrame = scheduledFrame + m_actionDelay;
+        }
+    }
+
+    return plan;
+}
+
+void TickScheduler::MarkReady(uint64_t decisionId) {
+    m_readyId = std::max(m_readyId, decisionId);
+}
+
+bool TickScheduler::TakeApply(uint32_t frame) {
+    bool deadlineReached = (frame >= m_deadlineFrame);
+
+    if (m_readyId <= m_appliedId) {
+        // Nothing new to apply, so the previous controls stay
+        if (m_decisionId > m_appliedId && deadlineReached)
+            RecordMiss(m_decisionId);
+        return false;
+    }
+
+    // Only the current decision can still be ahead of its deadline
+    uint32_t lagFrames = 0;
+    if (m_readyId == m_decisionId) {
+        if (!deadlineReached)
+            return false;
+
+        lagFrames = frame - m_deadlineFrame;
+    } else if (m_readyId + 1 == m_decisionId) {
+        lagFrames = frame - m_prevDeadlineFrame;
+    }
+    m_stats.maxApplyLagFrames = std::max(m_stats.maxApplyLagFrames, lagFrames);
+
+    // Ready but past its deadline, e.g. a synchronous decision that took longer than the action delay
+    if (lagFrames > 0)
+        RecordMiss(m_readyId);
+
+    m_appliedId = m_readyId;
+    return true;
+}
+
+void TickScheduler::RecordMiss(uint64_t decisionId) {
+    if (decisionId > m_lastMissId) {
+        m_stats.numMissed++;
+        m_lastMissId = decisionId;
+    }
+}
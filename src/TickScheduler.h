@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+struct TickPlan {
+    bool decide = false;  // Start decision GetDecisionId() on this packet
+    int framesElapsed = 0; // Since the previous packet, 0 on the first one and on duplicates
+};
+
+struct TickSchedulerStats {
+    uint64_t numPackets = 0, numDecisions = 0;
+    uint64_t numMissed = 0;        // Actions that weren't ready by their deadline, the previous controls were kept until they were
+    uint64_t numLateDecisions = 0; // Decisions started after their scheduled frame because no packet arrived on it
+    uint64_t numSkippedFrames = 0; // Frames no packet arrived for
+    uint64_t numResyncs = 0;       // Schedule re-anchored after a frame counter reset or a gap longer than a decision period
+    uint32_t maxApplyLagFrames = 0; // Worst deadline -> applied frame
+};
+
+// Decides on which packets to decide and to apply actions, keyed off the packet frame numbers (120 per second)
+// Decisions are scheduled every tickSkip frames, and each decision's action is due actionDelay (< tickSkip) frames after its scheduled frame
+// The first decision (and the first after the frame counter restarts) is due right away, as there are no controls to hold until then
+// Dropped or jittery packets can't shift that grid: a late packet only starts its decision late, the deadline stays put
+class TickScheduler {
+public:
+    TickScheduler(int tickSkip, int actionDelay);
+
+    TickPlan OnPacket(uint32_t frame);
+
+    // Decisions are numbered from 1
+    uint64_t GetDecisionId() const { return m_decisionId; }
+
+    // The action of decisionId is available (any older ones are superseded)
+    void MarkReady(uint64_t decisionId);
+
+    // Call after OnPacket() and before deciding, so a due action goes out before the next decision replaces it
+    // True if the newest ready action should go out now: its deadline was reached, or was already missed
+    // When a deadline is reached without the action being ready, the miss is recorded and the caller keeps its controls
+    bool TakeApply(uint32_t frame);
+
+    const TickSchedulerStats& GetStats() const { return m_stats; }
+
+private:
+    int m_tickSkip, m_actionDelay;
+
+    bool m_started = false;
+    uint32_t m_lastFrame = 0;
+    uint32_t m_nextDecisionFrame = 0, m_deadlineFrame = 0, m_prevDeadlineFrame = 0;
+
+    uint64_t m_decisionId = 0, m_readyId = 0, m_appliedId = 0;
+    uint64_t m_lastMissId = 0; // Newest decision counted as missed, so each is counted once
+
+    TickSchedulerStats m_stats;
+
+    void RecordMiss(uint64_t decisionId);
+};
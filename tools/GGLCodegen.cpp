@@ -0,0 +1,145 @@
+// Turns .lt checkpoints into a C++ header with the network baked in (see GigaLearnCPP/CompiledKernels.h)
+// Build GGLBot with -DGGLBOT_COMPILED_MODEL=<header> to use it, that exe then needs no model files or libtorch
+//
+// Usage:
+//   GGLCodegen --models <folder> --out <header> --obs-size <n> --actions <n>
+//       [--shared-head 256,256] [--policy 256,256,256] [--activation relu|leaky_relu|sigmoid|tanh] [--no-layer-norm]
+//
+// The sizes and model configs must match your InferUnit setup in RLBotMain.cpp
+
+#include "ToolArgs.h"
+
+#include <GigaLearnCPP/InferPlan.h>
+
+#include <fstream>
+
+using namespace GGL;
+
+namespace {
+	const char* GetActivationEnumName(ModelActivationType type) {
+		switch (type) {
+		case ModelActivationType::RELU:       return "RELU";
+		case ModelActivationType::LEAKY_RELU: return "LEAKY_RELU";
+		case ModelActivationType::SIGMOID:    return "SIGMOID";
+		case ModelActivationType::TANH:       return "TANH";
+		}
+		RG_ERR_CLOSE("GGLCodegen: Unknown activation function type: " << (int)type);
+	}
+
+	// Hex float literals are exact, so the baked weights match the checkpoint bit for bit
+	void WriteFloatArray(std::ostream& out, const char* name, const float* data, size_t size) {
+		out << "\talignas(64) inline constexpr float " << name << "[" << size << "] = {";
+		for (size_t i = 0; i < size; i++) {
+			if (i % 8 == 0)
+				out << "\n\t\t";
+			out << std::hexfloat << data[i] << std::defaultfloat << "f,";
+		}
+		out << "\n\t};\n\n";
+	}
+
+	void WriteHeader(const ModelToolArgs& args, const Native::Network& network, std::ostream& out) {
+		int maxWidth = 0;
+		for (auto& layer : network.layers)
+			maxWidth = RS_MAX(maxWidth, layer.outSize);
+
+		out <<
+			"// Generated by GGLCodegen from " << args.modelsFolder.string() << ", do not edit\n"
+			"#pragma once\n\n"
+			"#include <GigaLearnCPP/CompiledKernels.h>\n\n"
+			"namespace GGL::CompiledModel {\n\n"
+			"\tconstexpr int OBS_SIZE = " << network.numInputs << ";\n"
+			"\tconstexpr int NUM_ACTIONS = " << network.numOutputs << ";\n"
+			"\tconstexpr int MAX_WIDTH = " << maxWidth << ";\n"
+			"\tconstexpr const char* SOURCE_FOLDER = R\"(" << args.modelsFolder.string() << ")\";\n\n";
+
+		for (size_t i = 0; i < network.layers.size(); i++) {
+			auto& layer = network.layers[i];
+			std::string prefix = "L" + std::to_string(i);
+
+			if (layer.type == Native::Layer::Type::LINEAR) {
+				// Transposed to [inSize, outSize], see Compiled::Linear()
+				std::vector<float> weightT((size_t)layer.inSize * layer.outSize);
+				for (int o = 0; o < layer.outSize; o++)
+					for (int k = 0; k < layer.inSize; k++)
+						weightT[(size_t)k * layer.outSize + o] = layer.weight[(size_t)o * layer.inSize + k];
+
+				std::vector<float> bias(layer.outSize, 0.f);
+				if (!layer.bias.empty())
+					std::copy(layer.bias.begin(), layer.bias.end(), bias.begin());
+
+				WriteFloatArray(out, (prefix + "_WEIGHT_T").c_str(), weightT.data(), weightT.size());
+				WriteFloatArray(out, (prefix + "_BIAS").c_str(), bias.data(), bias.size());
+			} else if (layer.type == Native::Layer::Type::LAYER_NORM) {
+				WriteFloatArray(out, (prefix + "_GAMMA").c_str(), layer.weight.data(), layer.weight.size());
+				WriteFloatArray(out, (prefix + "_BETA").c_str(), layer.bias.data(), layer.bias.size());
+			}
+		}
+
+		out <<
+			"\t// in is [OBS_SIZE], out is [NUM_ACTIONS]\n"
+			"\tinline void Forward(const float* in, float* out) {\n"
+			"\t\talignas(64) float bufA[MAX_WIDTH], bufB[MAX_WIDTH];\n\n";
+
+		// Linears ping-pong between the two buffers, everything else runs in place
+		// The final linear writes straight to out
+		std::string cur = "in";
+		bool curIsA = false;
+		for (size_t i = 0; i < network.layers.size(); i++) {
+			auto& layer = network.layers[i];
+			std::string prefix = "L" + std::to_string(i);
+			bool isLast = (i == network.layers.size() - 1);
+
+			switch (layer.type) {
+			case Native::Layer::Type::LINEAR:
+			{
+				std::string dest = isLast ? "out" : (curIsA ? "bufB" : "bufA");
+				out <<
+					"\t\tCompiled::Linear<" << layer.inSize << ", " << layer.outSize << ">(" <<
+					cur << ", " << prefix << "_WEIGHT_T, " << prefix << "_BIAS, " << dest << ");\n";
+				cur = dest;
+				curIsA = (dest == "bufA");
+				break;
+			}
+			case Native::Layer::Type::LAYER_NORM:
+				out <<
+					"\t\tCompiled::LayerNorm<" << layer.outSize << ">(" << cur << ", " << prefix << "_GAMMA, " << prefix << "_BETA, " <<
+					std::hexfloat << layer.eps << std::defaultfloat << "f);\n";
+				break;
+			case Native::Layer::Type::ACTIVATION:
+				out <<
+					"\t\tCompiled::Activation<" << layer.outSize << ", ModelActivationType::" << GetActivationEnumName(layer.activationType) << ">(" <<
+					cur << ", " << std::hexfloat << layer.negativeSlope << std::defaultfloat << "f);\n";
+				break;
+			}
+		}
+
+		if (cur != "out")
+			out << "\n\t\tfor (int i = 0; i < NUM_ACTIONS; i++)\n\t\t\tout[i] = " << cur << "[i];\n";
+
+		out << "\t}\n}\n";
+	}
+}
+
+int main(int argc, char** argv) {
+	auto args = ParseModelToolArgs(argc, argv, "GGLCodegen");
+
+	RG_NO_GRAD;
+
+	ModelSet models = {};
+	LoadToolModels(args, models, true);
+
+	Native::Network network = {};
+	if (models["shared_head"])
+		network.AppendModel(*models["shared_head"]);
+	network.AppendModel(*models["policy"]);
+
+	std::ofstream out(args.outPath);
+	if (!out.good())
+		RG_ERR_CLOSE("GGLCodegen: Failed to open " << args.outPath << " for writing");
+
+	WriteHeader(args, network, out);
+	out.close();
+
+	RG_LOG("GGLCodegen: Wrote " << network.layers.size() << " layers (" << network.numInputs << " -> " << network.numOutputs << ") to " << args.outPath);
+	return 0;
+}
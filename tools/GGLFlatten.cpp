@@ -0,0 +1,31 @@
+// Converts .lt checkpoints into flat weight files (.ggw, see GigaLearnCPP/FlatWeights.h)
+// GGLBot memory-maps these instead of parsing the .lt, so every bot process on the host shares one copy of the weights
+//
+// Usage:
+//   GGLFlatten --models <folder> --obs-size <n> --actions <n> [--out <folder>]
+//       [--shared-head 256,256] [--policy 256,256,256] [--activation relu|leaky_relu|sigmoid|tanh] [--no-layer-norm]
+//
+// The .ggw files are written next to the .lt files unless --out is given
+
+#include "ToolArgs.h"
+
+using namespace GGL;
+
+int main(int argc, char** argv) {
+	auto args = ParseModelToolArgs(argc, argv, "GGLFlatten", false);
+	auto outFolder = args.outPath.empty() ? args.modelsFolder : args.outPath;
+
+	RG_NO_GRAD;
+
+	// Always convert from the .lt, an existing .ggw might be stale
+	ModelSet models = {};
+	LoadToolModels(args, models, false);
+
+	for (auto& pair : models.map) {
+		auto model = pair.second;
+		model->SaveFlat(outFolder);
+		RG_LOG("GGLFlatten: Wrote \"" << model->modelName << "\" to " << model->GetFlatSavePath(outFolder));
+	}
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Command line handling shared by the model conversion tools (GGLCodegen, GGLFlatten)
+// The sizes and model configs must match your InferUnit setup in RLBotMain.cpp
+
+#include <GigaLearnCPP/Models.h>
+#include <GigaLearnCPP/InferenceModels.h>
+
+#include <sstream>
+
+namespace GGL {
+
+	struct ModelToolArgs {
+		std::filesystem::path modelsFolder, outPath;
+		int obsSize = -1, numActions = -1;
+		std::vector<int> sharedHeadSizes = { 256, 256 };
+		std::vector<int> policySizes = { 256, 256, 256 };
+		ModelActivationType activationType = ModelActivationType::RELU;
+		bool addLayerNorm = true;
+	};
+
+	inline std::vector<int> ParseSizeList(const std::string& str) {
+		std::vector<int> sizes;
+		std::stringstream stream(str);
+		std::string part;
+		while (std::getline(stream, part, ','))
+			if (!part.empty())
+				sizes.push_back(std::stoi(part));
+		return sizes;
+	}
+
+	inline ModelActivationType ParseActivation(const std::string& str) {
+		if (str == "relu")       return ModelActivationType::RELU;
+		if (str == "leaky_relu") return ModelActivationType::LEAKY_RELU;
+		if (str == "sigmoid")    return ModelActivationType::SIGMOID;
+		if (str == "tanh")       return ModelActivationType::TANH;
+		RG_ERR_CLOSE("Unknown activation \"" << str << "\"");
+	}
+
+	// --models <folder> --obs-size <n> --actions <n> [--out <path>]
+	// [--shared-head 256,256] [--policy 256,256,256] [--activation relu|leaky_relu|sigmoid|tanh] [--no-layer-norm]
+	inline ModelToolArgs ParseModelToolArgs(int argc, char** argv, const char* toolName, bool requireOut = true) {
+		ModelToolArgs args = {};
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= argc)
+					RG_ERR_CLOSE(toolName << ": Missing value after " << arg);
+				return argv[++i];
+			};
+
+			if (arg == "--models")              args.modelsFolder = next();
+			else if (arg == "--out")            args.outPath = next();
+			else if (arg == "--obs-size")       args.obsSize = std::stoi(next());
+			else if (arg == "--actions")        args.numActions = std::stoi(next());
+			else if (arg == "--shared-head")    args.sharedHeadSizes = ParseSizeList(next());
+			else if (arg == "--policy")         args.policySizes = ParseSizeList(next());
+			else if (arg == "--activation")     args.activationType = ParseActivation(next());
+			else if (arg == "--no-layer-norm")  args.addLayerNorm = false;
+			else RG_ERR_CLOSE(toolName << ": Unknown argument \"" << arg << "\"");
+		}
+
+		if (args.modelsFolder.empty() || args.obsSize <= 0 || args.numActions <= 0)
+			RG_ERR_CLOSE(toolName << ": --models, --obs-size and --actions are required");
+		if (requireOut && args.outPath.empty())
+			RG_ERR_CLOSE(toolName << ": --out is required");
+
+		return args;
+	}
+
+	// Builds shared_head + policy the same way InferUnit does and loads them from args.modelsFolder
+	inline void LoadToolModels(const ModelToolArgs& args, ModelSet& outModels, bool allowFlat) {
+		InferPartialModelConfig sharedHeadConfig = {};
+		sharedHeadConfig.layerSizes = args.sharedHeadSizes;
+		sharedHeadConfig.activationType = args.activationType;
+		sharedHeadConfig.addLayerNorm = args.addLayerNorm;
+		sharedHeadConfig.addOutputLayer = false;
+
+		InferPartialModelConfig policyConfig = {};
+		policyConfig.layerSizes = args.policySizes;
+		policyConfig.activationType = args.activationType;
+		policyConfig.addLayerNorm = args.addLayerNorm;
+		policyConfig.addOutputLayer = true;
+
+		Infer::MakeInferenceModels(args.obsSize, args.numActions, sharedHeadConfig, policyConfig, torch::kCPU, outModels);
+		for (auto& pair : outModels.map)
+			pair.second->Load(args.modelsFolder, false, allowFlat);
+	}
+}